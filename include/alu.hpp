@@ -0,0 +1,114 @@
+#ifndef ALU_HPP
+#define ALU_HPP
+#include <stdint.h>
+#include <array>
+
+// Bits of the F register
+constexpr uint8_t FLAG_Z = 1 << 7;
+constexpr uint8_t FLAG_N = 1 << 6;
+constexpr uint8_t FLAG_H = 1 << 5;
+constexpr uint8_t FLAG_C = 1 << 4;
+
+// Flag-setting ALU operations, see Cpu::set_flags()
+enum FlagOp : uint8_t {
+    FLAGS_NONE,
+    FLAGS_ADD, // ADD, ADC
+    FLAGS_SUB, // SUB, SBC, CP
+    FLAGS_AND,
+    FLAGS_OR,  // OR, XOR
+    FLAGS_INC,
+    FLAGS_DEC
+};
+
+// ADD/SUB flags come from the 9-bit result: bit 4 of a ^ b ^ result is the
+// carry into bit 4 (H) and bit 8 the carry out (C). That is as few
+// instructions as a (carry, a, b) table lookup without its 128 KiB per op.
+constexpr unsigned int alu_wide(uint8_t op, uint8_t a, uint8_t b, bool carry)
+{
+    return op == FLAGS_SUB ? a - b - carry : a + b + carry;
+}
+
+constexpr bool alu_c(uint8_t op, uint8_t a, uint8_t b, bool carry)
+{
+    switch(op) {
+        case FLAGS_ADD: case FLAGS_SUB: return (alu_wide(op, a, b, carry) >> 8) & 1;
+        case FLAGS_INC: case FLAGS_DEC: return carry; // preserved
+        default: return false;
+    }
+}
+
+// F after a FlagOp. carry is the carry in for ADC/SBC and the preserved
+// carry for INC/DEC.
+constexpr uint8_t alu_flags(uint8_t op, uint8_t a, uint8_t b, uint8_t res, bool carry)
+{
+    uint8_t z = res == 0 ? FLAG_Z : 0;
+    switch(op) {
+        case FLAGS_ADD: case FLAGS_SUB: {
+            unsigned int wide = alu_wide(op, a, b, carry);
+            return z | (op == FLAGS_SUB ? FLAG_N : 0) | (((a ^ b ^ wide) & 0x10) << 1) | ((wide >> 4) & FLAG_C);
+        }
+        case FLAGS_AND: return z | FLAG_H;
+        case FLAGS_INC: return z | ((a & 0xf) == 0xf ? FLAG_H : 0) | (carry ? FLAG_C : 0);
+        case FLAGS_DEC: return z | FLAG_N | ((a & 0xf) == 0 ? FLAG_H : 0) | (carry ? FLAG_C : 0);
+        default: return z;
+    }
+}
+
+struct AluResult {
+    uint8_t v;
+    uint8_t f;
+};
+
+// DAA indexed by (((F >> 4) & 7) << 8) | A, N is kept and H cleared. Its
+// adjustment is a chain of data-dependent branches, the table is 4 KiB.
+constexpr std::array<AluResult, 0x800> make_daa()
+{
+    std::array<AluResult, 0x800> t{};
+    for (unsigned int i = 0; i < 0x800; i++) {
+        uint8_t f = (i >> 8) << 4;
+        int16_t result = i & 0xff;
+        if (f & FLAG_N) {
+            if (f & FLAG_H) result = (result - 0x06) & 0xFF;
+            if (f & FLAG_C) result -= 0x60;
+        } else {
+            if ((f & FLAG_H) || (result & 0x0F) > 0x09) result += 0x06;
+            if ((f & FLAG_C) || result > 0x9F) result += 0x60;
+        }
+        if ((result & 0x100) == 0x100) f |= FLAG_C;
+        f &= ~(FLAG_Z | FLAG_H);
+        if ((result & 0xff) == 0) f |= FLAG_Z;
+        t[i] = { (uint8_t)(result & 0xff), f };
+    }
+    return t;
+}
+
+// CB rotates and shifts (RLC RRC RL RR SLA SRA SWAP SRL), indexed by
+// (op << 9) | (carry << 8) | v
+constexpr std::array<AluResult, 0x1000> make_shift()
+{
+    std::array<AluResult, 0x1000> t{};
+    for (unsigned int i = 0; i < 0x1000; i++) {
+        unsigned int op = i >> 9;
+        unsigned int carry = (i >> 8) & 1;
+        uint8_t v = i & 0xff;
+        uint8_t res = 0;
+        bool c = false;
+        switch(op) {
+            case 0: res = (v << 1) | (v >> 7); c = v >> 7; break;
+            case 1: res = (v >> 1) | (v << 7); c = v & 1; break;
+            case 2: res = (v << 1) | carry; c = v >> 7; break;
+            case 3: res = (v >> 1) | (carry << 7); c = v & 1; break;
+            case 4: res = v << 1; c = v >> 7; break;
+            case 5: res = (v >> 1) | (v & 0x80); c = v & 1; break;
+            case 6: res = (v << 4) | (v >> 4); c = false; break;
+            default: res = v >> 1; c = v & 1; break;
+        }
+        t[i] = { res, (uint8_t)((res == 0 ? FLAG_Z : 0) | (c ? FLAG_C : 0)) };
+    }
+    return t;
+}
+
+inline constexpr std::array<AluResult, 0x800> g_daa = make_daa();
+inline constexpr std::array<AluResult, 0x1000> g_shift = make_shift();
+
+#endif // ALU_HPP
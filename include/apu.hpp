@@ -47,6 +47,7 @@ struct Pulse {
     uint16_t wavelength() const;
     int value() const;
     void tick(int cycles, uint8_t& sound_on);
+    int cycles_until_event() const;
     int gain() const;
     void trigger();
 
@@ -63,19 +64,29 @@ private:
     uint8_t channel_num;
 };
 
-struct Apu {
-    Apu(SDL_AudioDeviceID audio_dev, SDL_AudioSpec audio_spec);
-    void exec(uint8_t cycles);
+struct Cpu;
+
+// The part of Apu that Machine snapshots
+struct ApuState {
+    ApuState(): pulseA(0), pulseB(1), sound_on(0), elapsed_cycles(0) {}
 
-    SDL_AudioDeviceID audio_dev;
-    SDL_AudioSpec audio_spec;
     Pulse pulseA;
     Pulse pulseB;
 
     uint8_t sound_on;
-
-private:
     int elapsed_cycles;
 };
 
+struct Apu: ApuState {
+    Apu(SDL_AudioDeviceID audio_dev, SDL_AudioSpec audio_spec);
+    void exec(unsigned int cycles);
+    // Cycles until the next sample or channel timer event, ~0 when the
+    // sound is off
+    unsigned int cycles_until_event() const;
+    void map_io(Cpu& cpu);
+
+    SDL_AudioDeviceID audio_dev;
+    SDL_AudioSpec audio_spec;
+};
+
 #endif //GBEMU_APU_HPP
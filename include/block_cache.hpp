@@ -0,0 +1,106 @@
+#ifndef BLOCK_CACHE_HPP
+#define BLOCK_CACHE_HPP
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+struct Cpu;
+
+typedef unsigned int (*NativeBlock)(Cpu* cpu);
+
+// An instruction decoded once: the opcode selects the handler in
+// Cpu::executeInstruction, the operand bytes are already fetched.
+struct DecodedInstr
+{
+    uint8_t opcode;
+    uint8_t length;
+    uint8_t cycles;
+    // Fusion starting at this instruction, set by the block cache
+    uint8_t fusion;
+    uint16_t operand;
+};
+
+// Straight-line run of instructions ending at the first control flow
+// instruction or at the end of the memory region it was decoded from.
+struct Block
+{
+    uint16_t start;
+    uint16_t end;
+    std::vector<DecodedInstr> instrs;
+
+    // used by the JIT
+    unsigned int entry_count;
+    NativeBlock native;
+    // most cycles the compiled code can take, branches taken
+    unsigned int native_cycles;
+};
+
+constexpr unsigned int BLOCK_MAX_INSTRS = 64;
+// WRAM (echo RAM included) followed by HRAM
+constexpr unsigned int RAM_CODE_SIZE = 0x2000 + 0x80;
+
+class BlockCache
+{
+public:
+    BlockCache();
+
+    // Returns the decoded instruction at cpu.pc, or nullptr if pc is in a
+    // region that is not cached (VRAM, cartridge RAM, OAM, I/O).
+    // Caching code from WRAM takes the page out of cpu.write_map.
+    const DecodedInstr* fetch(Cpu& cpu);
+    // Same as fetch() without moving past the instruction
+    const DecodedInstr* peek(Cpu& cpu);
+    // Returns the block starting at cpu.pc and moves the cursor to it, or
+    // nullptr if the cursor is in the middle of a block.
+    Block* enter(Cpu& cpu);
+    Block* lookup(Cpu& cpu, uint16_t pc);
+    void clear();
+    // Drops the blocks decoded from WRAM/HRAM, ROM blocks stay
+    void flush_ram();
+
+    // Must be called on every write to WRAM/HRAM (offset into RAM_CODE_SIZE)
+    void ram_written(unsigned int offset)
+    {
+        if (ram_code[offset]) flush_ram();
+    }
+
+    // page is an offset into RAM_CODE_SIZE divided by 256
+    bool ram_page_has_code(unsigned int page) const
+    {
+        return ram_code_pages[page];
+    }
+
+    // Must be called on every MBC control write
+    void bank_switched()
+    {
+        current = nullptr;
+        code_changed = true;
+    }
+
+    void reset_cursor()
+    {
+        current = nullptr;
+    }
+
+    // Set when previously decoded code may be stale, checked by compiled blocks
+    bool code_changed;
+
+private:
+    void decode_block(Cpu& cpu, Block& block, uint16_t region_end);
+
+    // cursor, read on every fetch
+    Block* current;
+    unsigned int next_index;
+    uint16_t next_pc;
+
+    // keyed by (bank << 16) | address
+    std::unordered_map<uint32_t, Block> rom_blocks;
+    // keyed by address
+    std::unordered_map<uint32_t, Block> ram_blocks;
+
+    // RAM bytes covered by a block in ram_blocks
+    bool ram_code[RAM_CODE_SIZE];
+    bool ram_code_pages[(RAM_CODE_SIZE + 0xff) >> 8];
+};
+
+#endif // BLOCK_CACHE_HPP
@@ -2,6 +2,15 @@
 #define GBEMU_CPU_HPP
 #include <stdint.h>
 #include <cstdio>
+#include <array>
+#include <utility>
+#include "block_cache.hpp"
+#include "jit.hpp"
+#include "fusion.hpp"
+#include "speedhacks.hpp"
+#include "scheduler.hpp"
+#include "timing.hpp"
+#include "alu.hpp"
 
 struct Apu;
 struct Ppu;
@@ -9,28 +18,71 @@ class Timer;
 
 struct SideEffects
 {
-    uint8_t cycles;
+    unsigned int cycles;
     bool break_;
 };
 
+struct RunResult
+{
+    unsigned int cycles;
+    unsigned int instructions;
+    bool break_;
+};
+
+// regs indices, laid out so that each pair can also be read as a native
+// uint16_t through Cpu::pairs (high register at the higher address on
+// little-endian hosts)
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define GBEMU_BIG_ENDIAN
 enum Registers {
-    REG_A,
-    REG_B,
-    REG_C,
-    REG_D,
-    REG_E,
-    REG_L,
-    REG_H
+    REG_A, REG_F,
+    REG_B, REG_C,
+    REG_D, REG_E,
+    REG_H, REG_L
 };
+#else
+enum Registers {
+    REG_F, REG_A,
+    REG_C, REG_B,
+    REG_E, REG_D,
+    REG_L, REG_H
+};
+#endif
+
+enum RegisterPairs {
+    PAIR_AF,
+    PAIR_BC,
+    PAIR_DE,
+    PAIR_HL
+};
+
+// 3-bit register operand of the regular opcode blocks -> regs index, 0xff for (HL)
+constexpr uint8_t operand_regs[8] = { REG_B, REG_C, REG_D, REG_E, REG_H, REG_L, 0xff, REG_A };
 
 struct Cpu;
 
+typedef uint8_t (*IoReadFn)(void* ctx);
+typedef void (*IoWriteFn)(void* ctx, uint8_t v);
+
+// One register in 0xFF00-0xFF7F. Plain registers only set value, read and
+// write override it. Bits set in read_mask always read as 1. Unmapped
+// registers read as 0xFF.
+struct IoRegister
+{
+    uint8_t* value;
+    IoReadFn read;
+    IoWriteFn write;
+    void* ctx;
+    uint8_t read_mask;
+};
+
 struct SerialController
 {
-    SerialController(Cpu* cpu);
-    void exec(uint8_t cycles);
+    SerialController();
+    // Raises the serial interrupt in if_ at the end of a transfer
+    void exec(uint8_t cycles, uint8_t& if_);
+    void map_io(Cpu& cpu);
 
-    Cpu* cpu;
     int remaining;
     int remaining_bits;
 
@@ -41,57 +93,199 @@ struct JoypadController
 {
     JoypadController();
     uint8_t joyp() const;
+    void map_io(Cpu& cpu);
     bool select_buttons;
     uint8_t buttons_state;
     uint8_t directions_state;
 };
 
 struct Mbc;
+struct Machine;
 
-struct Cpu
+// The part of Cpu that Machine snapshots: registers, interrupt state and
+// the clock. Pointer-free so that it can be copied as is. run() touches
+// everything up to scheduler.next on every instruction, keep it in the
+// first cache line (checked in cpu.cpp).
+struct CpuState
+{
+    union {
+        uint8_t regs[8];
+        uint16_t pairs[4];
+    };
+    uint16_t sp, pc;
+#ifdef GBEMU_LAZY_FLAGS
+    // Last flag-setting ALU operation. While flag_op != FLAGS_NONE, the
+    // flag bits of F are stale and have to be recomputed by sync_flags().
+    uint8_t flag_op;
+    uint8_t flag_a, flag_b, flag_res;
+    bool flag_carry;
+#endif
+
+    bool ime;
+    // set by EI, ime follows once the next instruction has run
+    bool ime_pending;
+    uint8_t ie, if_;
+
+    bool halted;
+
+    // Cycles since power on. With lazy_sync, run() only ticks the timer,
+    // PPU or APU when its next event in scheduler is due or when one of
+    // its I/O registers is accessed. Nothing the CPU can observe changes
+    // in between, so this gives the same results as ticking them after
+    // every instruction.
+    uint64_t clock;
+    // Without lazy_sync every peripheral is due after every instruction
+    Scheduler scheduler;
+
+    SerialController serial;
+    JoypadController joypad;
+
+    // Flag bits of F, the low nibble always reads as 0
+    bool z() const { return regs[REG_F] & FLAG_Z; }
+    bool n() const { return regs[REG_F] & FLAG_N; }
+    bool h() const { return regs[REG_F] & FLAG_H; }
+    bool c() const { return regs[REG_F] & FLAG_C; }
+    void set_z(bool v) { set_flag(FLAG_Z, v); }
+    void set_n(bool v) { set_flag(FLAG_N, v); }
+    void set_h(bool v) { set_flag(FLAG_H, v); }
+    void set_c(bool v) { set_flag(FLAG_C, v); }
+    void set_flag(uint8_t flag, bool v) { regs[REG_F] = (regs[REG_F] & ~flag) | (v ? flag : 0); }
+};
+
+// Bulk RAM of the CPU, at the end of Cpu so that it does not push the
+// fields run() uses apart
+struct CpuMemory
+{
+    uint8_t wram[0x2000];
+    uint8_t hram[128];
+};
+
+// Data members go hot to cold: the ones run() uses on every instruction
+// directly follow CpuState, the bulk and debug-only ones come last.
+struct alignas(64) Cpu: CpuState
 {
     Cpu();
     ~Cpu();
+    // Call once ppu is set, speed hacks apply to it
     void load(const char* path);
     void reset();
-    SideEffects cycle();
+    // Runs until cycle_budget cycles have elapsed or a breakpoint is hit,
+    // ticking the PPU and APU along the way. The peripherals are up to
+    // date when it returns.
+    RunResult run(unsigned int cycle_budget);
+    // Runs steps instructions like run() does, halted stretches counting as
+    // one step each, and brings the peripherals up to date. Ignores the
+    // breakpoint.
+    RunResult run_steps(uint64_t steps);
+    // Copies the state of the CPU and of every component into m, or back.
+    // The peripherals must be up to date, as they are between run() calls.
+    // m must come from the same ROM.
+    void save(Machine& m);
+    void restore(const Machine& m);
 
     uint16_t af();
-    uint16_t bc();
-    uint16_t de();
-    uint16_t hl();
+    void sync_flags();
+    uint16_t bc() const { return pairs[PAIR_BC]; }
+    uint16_t de() const { return pairs[PAIR_DE]; }
+    uint16_t hl() const { return pairs[PAIR_HL]; }
+
+    void decode(uint16_t addr, DecodedInstr& instr);
 
-    uint8_t mem(uint16_t a, bool bypass = false) const;
-    bool memw(uint16_t a, uint8_t v);
+    // Plain ROM/RAM accesses go through the page table, everything else
+    // (I/O, locked VRAM/OAM, MBC registers) through mem_slow/memw_slow
+    uint8_t mem(uint16_t a, bool bypass = false)
+    {
+        if (const uint8_t* p = read_map[a >> 8]) return p[a & 0xff];
+        return mem_slow(a, bypass);
+    }
+    bool memw(uint16_t a, uint8_t v)
+    {
+        if (uint8_t* p = write_map[a >> 8]) {
+            p[a & 0xff] = v;
+            return false;
+        }
+        return memw_slow(a, v);
+    }
+    // Accesses made by an instruction, timed by CpuTiming
+    uint8_t bus_read(uint16_t a)
+    {
+        bus_cycle();
+        return mem(a);
+    }
+    void bus_write(uint16_t a, uint8_t v)
+    {
+        bus_cycle();
+        memw(a, v);
+    }
     void push(uint16_t v);
     uint8_t pop8();
     uint16_t pop16();
 
-    SerialController serial;
-    JoypadController joypad;
+    // Run of contiguous mapped pages decode() reads from, [fetch_start,
+    // fetch_end). Dropped whenever read_map changes.
+    const uint8_t* fetch_ptr;
+    uint32_t fetch_start, fetch_end;
+    void map_fetch(uint16_t addr);
+
+    uint16_t breakpoint;
+    bool lazy_sync;
+    bool use_jit;
+    // run() executes the sequences listed in fusion.hpp as a whole
+    bool use_fusion;
+    // fused polls spinning on a value that can't change yet fast-forward
+    // to the next peripheral event, needs use_fusion
+    bool skip_idle_loops;
+    // MCycleTiming: cycles of the current instruction already added to
+    // clock and offset of its next access from the start of the instruction
+    unsigned int instr_elapsed;
+    unsigned int next_access;
+
     Ppu* ppu;
     Apu* apu;
     Mbc* mbc;
     Timer* timer;
 
-    // uint8_t rom[0x8000];
-    uint8_t wram[0x2000];
-    uint8_t hram[128];
-    // uint8_t memory[0xffff];
-    uint8_t regs[7];
-    uint16_t sp, pc;
-    bool z, h, n, c;
-
-    bool ime;
-    uint8_t ie, if_;
+    // 256-byte pages, nullptr where the access has to take the slow path.
+    // WRAM pages holding cached code are not writable so that the block
+    // cache sees the write.
+    uint8_t* read_map[0x100];
+    uint8_t* write_map[0x100];
+    void map_memory();
+    // Must be called after MBC control writes
+    void map_cartridge();
+    // Must be called after PPU mode and LCDC changes
+    void map_video();
+    void map_wram();
 
-    bool halted;
+    // indexed by address - 0xFF00
+    IoRegister io[0x80];
+    void map_io(uint16_t a, uint8_t* value, uint8_t read_mask = 0);
+    void map_io(uint16_t a, void* ctx, uint8_t* value, IoReadFn read, IoWriteFn write, uint8_t read_mask = 0);
+    // Lets every component register its I/O ports, call once ppu, apu and
+    // timer are set
+    void map_io_ports();
 
-    uint16_t breakpoint;
+    BlockCache block_cache;
+    Jit jit;
+    IdleLoopLog idle_loops;
+    // from the cartridge header
+    char title[17];
+    // settings for this ROM from speedhacks.cpp, nullptr if it has none
+    const SpeedHack* speedhack;
+#ifdef GBEMU_FUSION_PROFILE
+    FusionProfile fusion_profile;
+#endif
+    CpuMemory memory;
 
 private:
+    friend class Jit;
+
+    void set_flags(uint8_t op, uint8_t a, uint8_t b, uint8_t res, bool carry);
+    bool carry_flag() const;
+    void prepare_flags(uint8_t opcode);
     void instr_add(uint8_t v);
     void instr_adc(uint8_t v);
+    void instr_add_hl(uint16_t v);
     void instr_sbc(uint8_t v);
     void instr_rst(uint16_t addr);
     void instr_inc8(uint8_t& v);
@@ -101,17 +295,73 @@ private:
     void instr_xor(uint8_t v);
     void instr_or(uint8_t v);
     void instr_cp(uint8_t v);
-    void instr_rl(uint8_t& v);
-    void instr_rlc(uint8_t& v);
-    void instr_rrc(uint8_t& v);
-    void instr_rr(uint8_t& v);
-    void instr_sla(uint8_t& v);
-    void instr_swap(uint8_t& v);
-    void instr_srl(uint8_t& v);
-    void instr_sra(uint8_t& v);
+    void instr_shift(uint8_t op, uint8_t& v);
     void daa();
-    void executeInstruction(uint8_t instr, SideEffects& eff);
-    void execPrefix(SideEffects& eff);
+    uint8_t serviceInterrupts();
+    uint8_t dispatch_interrupt();
+    unsigned int until_event(EventSource source) const;
+    unsigned int peripherals_until_event() const;
+    unsigned int cycles_until_event() const;
+    void catch_up(EventSource source);
+    void catch_up_all();
+    void schedule_all();
+    void sync();
+    void elapse(unsigned int cycles)
+    {
+        clock += cycles;
+        if (clock >= scheduler.next) sync();
+    }
+    // first_access is the offset of the first bus access, after the
+    // M-cycles that fetched the instruction
+    void begin_instruction(unsigned int first_access)
+    {
+        if constexpr (CpuTiming::per_access) next_access = first_access;
+    }
+    // M-cycle without a bus access before the next one
+    void internal_cycle()
+    {
+        if constexpr (CpuTiming::per_access) next_access += 4;
+    }
+    void bus_cycle()
+    {
+        if constexpr (CpuTiming::per_access) {
+            elapse(next_access - instr_elapsed);
+            instr_elapsed = next_access;
+            next_access += 4;
+        }
+    }
+    // Elapses what the accesses of the instruction left of its cycles
+    void finish_instruction(unsigned int cycles)
+    {
+        if constexpr (CpuTiming::per_access) {
+            cycles -= instr_elapsed;
+            instr_elapsed = 0;
+        }
+        elapse(cycles);
+    }
+    // Runs one instruction, or while halted skips to the next peripheral
+    // event but no further than halt_limit cycles. The caller advances the
+    // clock by the cycles it returns.
+    SideEffects step(unsigned int halt_limit);
+    unsigned int halt_cycles(unsigned int limit) const;
+    // an interrupt would be taken before the next instruction
+    bool interrupt_ready() const { return ime && (ie & if_ & 0x1f); }
+    void exec_fused(const DecodedInstr* instr, RunResult& res, unsigned int cycle_budget);
+    void skip_idle_loop(const DecodedInstr* instr, uint8_t value, RunResult& res, unsigned int cycle_budget);
+    uint8_t mem_slow(uint16_t a, bool bypass);
+    bool memw_slow(uint16_t a, uint8_t v);
+    void executeInstruction(const DecodedInstr& instr, SideEffects& eff);
+    void execPrefix(uint8_t instr);
+
+    typedef void (*OpHandler)(Cpu& cpu);
+    template<uint8_t r> uint8_t read_operand();
+    template<uint8_t r> void write_operand(uint8_t v);
+    template<uint8_t opcode> static void op_block(Cpu& cpu);
+    template<uint8_t cb> static void op_prefix(Cpu& cpu);
+    template<size_t... I> static constexpr std::array<OpHandler, sizeof...(I)> block_table(std::index_sequence<I...>);
+    template<size_t... I> static constexpr std::array<OpHandler, sizeof...(I)> prefix_table(std::index_sequence<I...>);
+    static const std::array<OpHandler, 0x80> block_handlers;
+    static const std::array<OpHandler, 0x100> prefix_handlers;
     
     void instr_bit(uint8_t v, uint8_t bit);
 
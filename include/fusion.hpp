@@ -0,0 +1,113 @@
+#ifndef FUSION_HPP
+#define FUSION_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "block_cache.hpp"
+
+#include <unordered_map>
+
+#ifdef GBEMU_FUSION_PROFILE
+#include <chrono>
+#include <vector>
+#endif
+
+// Hot instruction sequences that Cpu::exec_fused runs as one handler.
+// The peripherals are still ticked after every instruction of the
+// sequence, so the timing is the same as running them one by one.
+enum Fusion : uint8_t {
+    FUSE_NONE,
+    FUSE_COPY,       // LD A,(HL+) / LD (DE),A
+    FUSE_DEC_JRNZ,   // DEC r / JR NZ
+    FUSE_POLL_CP,    // LDH A,(n) / CP n / JR Z|NZ
+    FUSE_POLL_AND,   // LDH A,(n) / AND n / JR Z|NZ
+    FUSE_TEST_BC,    // LD A,B / OR C / JR NZ
+    FUSE_COUNT
+};
+
+struct FusionInfo {
+    const char* name;
+    uint8_t length;
+};
+
+extern const FusionInfo g_fusion_info[FUSE_COUNT];
+
+// Returns the fusion starting at instrs[0], count is the number of
+// instructions left in the block
+uint8_t match_fusion(const DecodedInstr* instrs, size_t count);
+
+// A poll whose JR jumps back to its own LDH spins until the value it
+// reads changes. These ports only change on a peripheral event (IF, STAT,
+// LY) or in an interrupt handler (HRAM), so Cpu can skip the iterations
+// up to the next event.
+bool idle_pollable(uint8_t port);
+
+struct IdleLoop
+{
+    uint16_t address;
+    uint16_t bank;
+    uint8_t fusion;
+    uint8_t port;
+    uint64_t skips;
+    uint64_t skipped_cycles;
+};
+
+// Idle loops seen while running a ROM, keyed by (bank << 16) | address
+struct IdleLoopLog
+{
+    void record(uint16_t address, uint16_t bank, uint8_t fusion, uint8_t port, unsigned int cycles);
+    void report(FILE* f, const char* title) const;
+
+    std::unordered_map<uint32_t, IdleLoop> loops;
+};
+
+#ifdef GBEMU_FUSION_PROFILE
+// Only one in FUSION_SAMPLE_RATE fused sequences is timed
+constexpr unsigned int FUSION_SAMPLE_RATE = 64;
+
+// Adjacent opcode statistics of the interpreter, to find new candidates
+// for fusion, and how often the existing ones fired.
+struct FusionProfile
+{
+    FusionProfile();
+
+    void record(uint8_t opcode)
+    {
+        history = (history << 8) | opcode;
+        if (++executed >= 2) pairs[history & 0xffff]++;
+        if (executed >= 3) triples[history & 0xffffff]++;
+    }
+
+    void report(FILE* f) const;
+
+    uint32_t history;
+    uint64_t executed;
+    std::vector<uint64_t> pairs;
+    std::unordered_map<uint32_t, uint64_t> triples;
+
+    // fired counts the sequences that were entered, instrs the
+    // instructions run through them (sequences stop early on interrupts)
+    uint64_t fired[FUSE_COUNT];
+    uint64_t instrs[FUSE_COUNT];
+
+    uint64_t sampled_ns[FUSE_COUNT];
+    uint64_t sampled_instrs[FUSE_COUNT];
+    uint64_t run_ns;
+};
+
+// Adds its lifetime to FusionProfile::run_ns
+struct FusionRunTimer
+{
+    FusionRunTimer(FusionProfile& profile): profile(profile), start(std::chrono::steady_clock::now()) {}
+    ~FusionRunTimer()
+    {
+        auto end = std::chrono::steady_clock::now();
+        profile.run_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    }
+
+    FusionProfile& profile;
+    std::chrono::steady_clock::time_point start;
+};
+#endif
+
+#endif // FUSION_HPP
@@ -0,0 +1,52 @@
+#ifndef JIT_HPP
+#define JIT_HPP
+#include <stdint.h>
+#include <stddef.h>
+#include "block_cache.hpp"
+
+struct Cpu;
+
+constexpr unsigned int JIT_HOT_THRESHOLD = 16;
+// Compiled blocks advance the clock only at exit, so exec() leaves
+// those that could run past the next peripheral event to the
+// interpreter. Shorter than the shortest PPU mode they rarely do.
+constexpr unsigned int JIT_MAX_BLOCK_CYCLES = 80;
+constexpr size_t JIT_CODE_SIZE = 4 << 20;
+constexpr size_t JIT_MAX_BLOCK_CODE = 4096;
+
+// x86-64 translator for hot blocks of the block cache. Simple register
+// operations are emitted inline, everything else calls back into
+// Cpu::executeInstruction with the clock it would have in the
+// interpreter. Interrupts and breakpoints are only checked between
+// blocks.
+class Jit
+{
+public:
+    Jit();
+    ~Jit();
+
+    // Runs the compiled block at cpu.pc, compiling it once it is hot.
+    // Returns the number of cycles executed, or 0 if the interpreter
+    // has to execute the next instruction, also when the block could
+    // reach the next peripheral event.
+    uint8_t exec(Cpu& cpu);
+
+private:
+    bool reserve();
+    NativeBlock compile(const Cpu& cpu, Block& block);
+    static unsigned int exec_instr(Cpu* cpu, uint64_t packed, unsigned int elapsed);
+    static uint64_t next_event(const Cpu& cpu);
+
+    void emit8(uint8_t v);
+    void emit16(uint16_t v);
+    void emit32(uint32_t v);
+    void emit64(uint64_t v);
+
+    uint8_t* code;
+    size_t code_used;
+    bool supported;
+    // clock at which the running block ends at the latest
+    uint64_t block_end;
+};
+
+#endif // JIT_HPP
@@ -0,0 +1,27 @@
+#ifndef MACHINE_HPP
+#define MACHINE_HPP
+#include <type_traits>
+#include "cpu.hpp"
+#include "ppu.hpp"
+#include "timer.hpp"
+#include "apu.hpp"
+#include "mbc.hpp"
+
+// All the mutable emulation state in one block without pointers, so that a
+// snapshot is copied or forked with a single memcpy. The ROM stays with the
+// Mbc and the caches derived from the state (page tables, code decoded from
+// RAM) are rebuilt by Cpu::restore. The structs have padding whose bytes are
+// unspecified, compare snapshots field by field rather than with memcmp.
+struct Machine
+{
+    CpuState cpu;
+    CpuMemory cpu_memory;
+    PpuState ppu;
+    TimerState timer;
+    ApuState apu;
+    MbcState mbc;
+};
+
+static_assert(std::is_trivially_copyable<Machine>::value, "Machine is copied with memcpy");
+
+#endif // MACHINE_HPP
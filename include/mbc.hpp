@@ -2,92 +2,124 @@
 #define MBC_HPP
 #include <cstdint>
 
-struct Mbc
+enum MbcType : uint8_t {
+    MBC_0,
+    MBC_1,
+    MBC_2,
+    MBC_3,
+    MBC_5
+};
+
+// The part of the controllers that Machine snapshots, each uses the
+// registers it has. The RAM is sized for the largest one, 16 banks on the
+// MBC5.
+struct MbcState
+{
+    bool ram_enabled;
+    uint16_t rom_bank;
+    uint8_t ram_bank;
+    uint8_t bank_mode;
+
+    bool clock_latch;
+    // TODO: real time clock
+    struct {
+        uint8_t seconds;
+        uint8_t minutes;
+        uint8_t hours;
+        uint8_t days_lo;
+        uint8_t days_hi;
+    } clock;
+
+    uint8_t ram[0x20000];
+};
+
+// The controller is chosen once in Cpu::load. Calls switch on type and go
+// straight to the final subclass instead of through a vtable, so the small
+// ones inline into the callers.
+struct Mbc: MbcState
 {
     virtual ~Mbc();
     void load(uint8_t* cartridge, unsigned int size);
-    virtual void reset() = 0;
-    virtual uint8_t mem(uint16_t a) = 0;
-    virtual void memw(uint16_t a, uint8_t v) = 0;
-
+    void reset();
+    uint8_t mem(uint16_t a);
+    void memw(uint16_t a, uint8_t v);
+    // bank mapped at 0x4000-0x7FFF
+    unsigned int current_rom_bank() const;
+    // RAM mapped at 0xA000-0xBFFF, nullptr if it is disabled or accesses
+    // need to go through mem/memw
+    uint8_t* ram_ptr();
+
+    MbcType type;
+    // read-only, not part of the state
     uint8_t* rom;
 };
 
-struct Mbc0: public Mbc
+struct Mbc0 final: public Mbc
 {
     Mbc0();
-    void reset() override;
-    uint8_t mem(uint16_t a) override;
-    void memw(uint16_t a, uint8_t v) override;
-
-    uint8_t ram[0x2000];
+    void reset();
+    uint8_t mem(uint16_t a);
+    void memw(uint16_t a, uint8_t v);
+    unsigned int current_rom_bank() const { return 1; }
+    uint8_t* ram_ptr() { return ram; }
 };
 
-struct Mbc1: public Mbc
+struct Mbc1 final: public Mbc
 {
     Mbc1();
-    void reset() override;
-    uint8_t mem(uint16_t a) override;
-    void memw(uint16_t a, uint8_t v) override;
-
-    bool ram_enabled;
-    uint8_t rom_bank;
-    uint8_t ram_bank;
-    uint8_t bank_mode;
-
-    uint8_t* ram;
+    void reset();
+    uint8_t mem(uint16_t a);
+    void memw(uint16_t a, uint8_t v);
+    unsigned int current_rom_bank() const { return rom_bank; }
+    uint8_t* ram_ptr() { return ram_enabled ? ram + 0x2000*ram_bank : nullptr; }
 };
 
-struct Mbc2: public Mbc
+struct Mbc2 final: public Mbc
 {
     Mbc2();
-    void reset() override;
-    uint8_t mem(uint16_t a) override;
-    void memw(uint16_t a, uint8_t v) override;
-
-    bool ram_enabled;
-    uint8_t rom_bank;
-
-    uint8_t ram[512];
+    void reset();
+    uint8_t mem(uint16_t a);
+    void memw(uint16_t a, uint8_t v);
+    unsigned int current_rom_bank() const { return rom_bank; }
+    uint8_t* ram_ptr() { return nullptr; } // only the low nibbles are stored, 512 of them
 };
 
-struct Mbc3: public Mbc
+struct Mbc3 final: public Mbc
 {
     Mbc3();
-    void reset() override;
-    uint8_t mem(uint16_t a) override;
-    void memw(uint16_t a, uint8_t v) override;
-
-    bool ram_enabled;
-    uint8_t rom_bank;
-    uint8_t ram_bank;
-
-    uint8_t* ram;
-
-    bool clock_latch;
-
-    // TODO: real time clock
-    struct {
-        uint8_t seconds;
-        uint8_t minutes;
-        uint8_t hours;
-        uint8_t days_lo;
-        uint8_t days_hi;
-    } clock;
+    void reset();
+    uint8_t mem(uint16_t a);
+    void memw(uint16_t a, uint8_t v);
+    unsigned int current_rom_bank() const { return rom_bank; }
+    // banks 8-C are the clock registers
+    uint8_t* ram_ptr() { return (ram_enabled && ram_bank <= 7) ? ram + 0x2000*ram_bank : nullptr; }
 };
 
-struct Mbc5: public Mbc
+struct Mbc5 final: public Mbc
 {
     Mbc5();
-    void reset() override;
-    uint8_t mem(uint16_t a) override;
-    void memw(uint16_t a, uint8_t v) override;
-
-    bool ram_enabled;
-    uint16_t rom_bank;
-    uint8_t ram_bank;
-
-    uint8_t* ram;
+    void reset();
+    uint8_t mem(uint16_t a);
+    void memw(uint16_t a, uint8_t v);
+    unsigned int current_rom_bank() const { return rom_bank; }
+    uint8_t* ram_ptr() { return ram_enabled ? ram + 0x2000*ram_bank : nullptr; }
 };
 
+#define MBC_DISPATCH(qual, call) \
+    switch(type) { \
+        case MBC_0: return static_cast<qual Mbc0*>(this)->Mbc0::call; \
+        case MBC_1: return static_cast<qual Mbc1*>(this)->Mbc1::call; \
+        case MBC_2: return static_cast<qual Mbc2*>(this)->Mbc2::call; \
+        case MBC_3: return static_cast<qual Mbc3*>(this)->Mbc3::call; \
+        default:    return static_cast<qual Mbc5*>(this)->Mbc5::call; \
+    }
+
+inline void Mbc::reset() { MBC_DISPATCH(, reset()) }
+inline uint8_t Mbc::mem(uint16_t a) { MBC_DISPATCH(, mem(a)) }
+inline void Mbc::memw(uint16_t a, uint8_t v) { MBC_DISPATCH(, memw(a, v)) }
+inline unsigned int Mbc::current_rom_bank() const { MBC_DISPATCH(const, current_rom_bank()) }
+inline uint8_t* Mbc::ram_ptr() { MBC_DISPATCH(, ram_ptr()) }
+
+#undef MBC_DISPATCH
+
 #endif // MBC_HPP
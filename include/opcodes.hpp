@@ -1,6 +1,7 @@
 #ifndef OPCODES_HPP
 #define OPCODES_HPP
 #include <stdint.h>
+#include <array>
 
 enum OperandType {
     OPERAND_NONE,
@@ -10,16 +11,79 @@ enum OperandType {
     OPERAND_RELATIVE
 };
 
+// Disassembly only
 struct Opcode {
     OperandType operand;
     const char* format_str;
+};
+
+extern const Opcode g_opcode_table[0x100];
+extern const Opcode g_prefix_opcode_table[0x100];
+
+// What the decoder and the dispatch loop need. For conditional branches
+// cycles is the cost when the branch is not taken.
+struct OpcodeInfo {
+    uint8_t length;
     uint8_t cycles;
+    uint8_t cycles_taken;
 };
 
-extern Opcode g_opcode_table[0x100];
-extern Opcode g_prefix_opcode_table[0x100];
+inline constexpr OpcodeInfo g_opcode_info[0x100] = {
+    {1, 4, 4}, {3,12,12}, {1, 8, 8}, {1, 8, 8}, {1, 4, 4}, {1, 4, 4}, {2, 8, 8}, {1, 4, 4}, // 0x00
+    {3,20,20}, {1, 8, 8}, {1, 8, 8}, {1, 8, 8}, {1, 4, 4}, {1, 4, 4}, {2, 8, 8}, {1, 4, 4},
+    {2, 4, 4}, {3,12,12}, {1, 8, 8}, {1, 8, 8}, {1, 4, 4}, {1, 4, 4}, {2, 8, 8}, {1, 4, 4}, // 0x10
+    {2,12,12}, {1, 8, 8}, {1, 8, 8}, {1, 8, 8}, {1, 4, 4}, {1, 4, 4}, {2, 8, 8}, {1, 4, 4},
+    {2, 8,12}, {3,12,12}, {1, 8, 8}, {1, 8, 8}, {1, 4, 4}, {1, 4, 4}, {2, 8, 8}, {1, 4, 4}, // 0x20
+    {2, 8,12}, {1, 8, 8}, {1, 8, 8}, {1, 8, 8}, {1, 4, 4}, {1, 4, 4}, {2, 8, 8}, {1, 4, 4},
+    {2, 8,12}, {3,12,12}, {1, 8, 8}, {1, 8, 8}, {1,12,12}, {1,12,12}, {2,12,12}, {1, 4, 4}, // 0x30
+    {2, 8,12}, {1, 8, 8}, {1, 8, 8}, {1, 8, 8}, {1, 4, 4}, {1, 4, 4}, {2, 8, 8}, {1, 4, 4},
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4}, // 0x40
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4},
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4}, // 0x50
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4},
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4}, // 0x60
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4},
+    {1, 8, 8}, {1, 8, 8}, {1, 8, 8}, {1, 8, 8}, {1, 8, 8}, {1, 8, 8}, {1, 4, 4}, {1, 8, 8}, // 0x70
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4},
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4}, // 0x80
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4},
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4}, // 0x90
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4},
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4}, // 0xA0
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4},
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4}, // 0xB0
+    {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 4, 4}, {1, 8, 8}, {1, 4, 4},
+    {1, 8,20}, {1,12,12}, {3,12,16}, {3,16,16}, {3,12,24}, {1,16,16}, {2, 8, 8}, {1,16,16}, // 0xC0
+    {1, 8,20}, {1,16,16}, {3,12,16}, {2, 8, 8}, {3,12,24}, {3,24,24}, {2, 8, 8}, {1,16,16},
+    {1, 8,20}, {1,12,12}, {3,12,16}, {1, 0, 0}, {3,12,24}, {1,16,16}, {2, 8, 8}, {1,16,16}, // 0xD0
+    {1, 8,20}, {1,16,16}, {3,12,16}, {1, 0, 0}, {3,12,24}, {1, 0, 0}, {2, 8, 8}, {1,16,16},
+    {2,12,12}, {1,12,12}, {1, 8, 8}, {1, 0, 0}, {1, 0, 0}, {1,16,16}, {2, 8, 8}, {1,16,16}, // 0xE0
+    {2,16,16}, {1, 4, 4}, {3,16,16}, {1, 0, 0}, {1, 0, 0}, {1, 0, 0}, {2, 8, 8}, {1,16,16},
+    {2,12,12}, {1,12,12}, {1, 8, 8}, {1, 4, 4}, {1, 0, 0}, {1,16,16}, {2, 8, 8}, {1,16,16}, // 0xF0
+    {2,12,12}, {1, 8, 8}, {3,16,16}, {1, 4, 4}, {1, 0, 0}, {1, 0, 0}, {2, 8, 8}, {1,16,16},
+};
+
+constexpr std::array<uint8_t, 0x100> make_prefix_cycles()
+{
+    std::array<uint8_t, 0x100> cycles{};
+    for (int i = 0; i < 0x100; i++) {
+        if ((i & 7) != 6) {
+            cycles[i] = 8;
+        } else {
+            cycles[i] = (i >= 0x40 && i < 0x80) ? 12 : 16; // BIT n,(HL) doesn't write back
+        }
+    }
+    return cycles;
+}
+
+// Total cost of CB xx, prefix included
+inline constexpr std::array<uint8_t, 0x100> g_prefix_cycles = make_prefix_cycles();
 
 uint8_t get_operand_num_bytes(OperandType opcode);
-void fill_opcode_table();
+
+inline uint8_t get_instruction_length(uint8_t opcode)
+{
+    return g_opcode_info[opcode].length;
+}
 
 #endif // OPCODES_HPP
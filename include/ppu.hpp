@@ -11,11 +11,30 @@
 
 struct Cpu;
 
-struct Ppu
+// The part of Ppu that Machine snapshots. The frame being drawn is output,
+// not state. Registers and counters first, exec() rarely needs more than
+// that cache line.
+struct PpuState
+{
+    uint8_t lcdc, stat, scy, scx, ly, lyc, dma, bgp, obp0, obp1, wy, wx;
+    int cycle_count;
+    unsigned int cycles_since_last_vblank;
+    unsigned int skipped_frames;
+
+    uint8_t oam[160];
+    uint8_t vram[0x2000];
+};
+
+struct Ppu: PpuState
 {
     Ppu();
     void reset();
-    void exec(uint8_t cycles);
+    // Raises interrupts in cpu.if_ and remaps VRAM when the mode changes
+    void exec(Cpu& cpu, unsigned int cycles);
+    // Cycles until the next mode change or LYC interrupt, ~0 when the LCD
+    // is off
+    unsigned int cycles_until_event() const;
+    void map_io(Cpu& cpu);
 
     bool vramaccess();
     bool oamaccess();
@@ -23,19 +42,12 @@ struct Ppu
     // palette index -> color code
     uint8_t palette(uint8_t p, uint8_t i);
 
-    uint8_t lcdc, stat, scy, scx, ly, lyc, dma, bgp, obp0, obp1, wy, wx;
-    uint8_t vram[0x2000];
-    uint8_t oam[160];
-
-    int cycle_count;
+    // Frames left undrawn after each drawn one
+    unsigned int frame_skip;
 
+    // written once per drawn scanline, last so that it stays out of the way
     uint32_t framebuf[160*144];
 
-    // TODO: don't store pointer to Cpu, take reference to IF register in exec() instead
-    Cpu* cpu;
-
-    unsigned int cycles_since_last_vblank;
-
 private:
     void draw_scanline();
 };
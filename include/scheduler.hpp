@@ -0,0 +1,55 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+#include <stdint.h>
+
+// Peripherals that schedule events on Cpu::clock, in the order they are
+// ticked when several are due at once. The serial port is not emulated and
+// OAM DMA completes instantly, so neither schedules anything yet.
+enum EventSource : uint8_t {
+    EVENT_TIMER,
+    EVENT_PPU,
+    EVENT_APU,
+    EVENT_SOURCE_COUNT
+};
+
+// Next event of each peripheral. A peripheral is only ticked up to the
+// clock when its own event is due or when the CPU accesses one of its
+// registers, synced[] records how far it has been ticked.
+struct Scheduler
+{
+    // earliest deadline, checked after every instruction
+    uint64_t next;
+    uint64_t synced[EVENT_SOURCE_COUNT];
+    uint64_t deadline[EVENT_SOURCE_COUNT];
+
+    // Everything up to date and due at clock
+    void reset(uint64_t clock)
+    {
+        for (unsigned int i = 0; i < EVENT_SOURCE_COUNT; i++) synced[i] = deadline[i] = clock;
+        next = clock;
+    }
+
+    void schedule(EventSource source, uint64_t when)
+    {
+        deadline[source] = when;
+        update_next();
+    }
+
+    void update_next()
+    {
+        next = deadline[0];
+        for (unsigned int i = 1; i < EVENT_SOURCE_COUNT; i++) {
+            if (deadline[i] < next) next = deadline[i];
+        }
+    }
+
+    bool all_synced(uint64_t clock) const
+    {
+        for (unsigned int i = 0; i < EVENT_SOURCE_COUNT; i++) {
+            if (synced[i] != clock) return false;
+        }
+        return true;
+    }
+};
+
+#endif // SCHEDULER_HPP
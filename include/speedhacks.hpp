@@ -0,0 +1,38 @@
+#ifndef SPEEDHACKS_HPP
+#define SPEEDHACKS_HPP
+#include <stdint.h>
+
+// Bump when the meaning of a field changes so that old entries get
+// checked again
+constexpr unsigned int SPEEDHACK_DB_VERSION = 1;
+constexpr unsigned int SPEEDHACK_MAX_WAIT_LOOPS = 4;
+
+struct SpeedHackLoop
+{
+    uint16_t bank;
+    uint16_t address;
+};
+
+// Per-title settings that are only safe because the game was checked
+// with them. Found by the header checksum (0x14D) and title (0x134).
+struct SpeedHack
+{
+    const char* title;
+    uint8_t header_checksum;
+
+    // Fused LDH polls that only exit after an interrupt or a peripheral
+    // event, skipped like the ones on the ports idle_pollable() accepts
+    uint8_t num_wait_loops;
+    SpeedHackLoop wait_loops[SPEEDHACK_MAX_WAIT_LOOPS];
+
+    // Frames left undrawn after each drawn one, the game never reads
+    // back what it displays
+    uint8_t frame_skip;
+
+    bool has_wait_loop(uint16_t bank, uint16_t address) const;
+};
+
+// Returns nullptr if the ROM is not in the database
+const SpeedHack* find_speedhack(uint8_t header_checksum, const char* title);
+
+#endif // SPEEDHACKS_HPP
@@ -7,17 +7,45 @@
 #include <cstdint>
 #include "cpu.hpp"
 
-struct Timer {
+// The part of Timer that Machine snapshots
+struct TimerState {
 
-    uint8_t div, tima, tma, tac;
+    uint8_t tma, tac;
+
+    // clock when the system counter was 0
+    uint64_t counter_start;
+    // TIMA was tima_base when the system counter was tima_counter
+    uint8_t tima_base;
+    uint64_t tima_counter;
+};
+
+// DIV and TIMA are derived from Cpu::clock when they are read, so the timer
+// only has work to do when TIMA overflows.
+struct Timer: TimerState {
 
     Timer();
-    void update(uint8_t cycles, Cpu& cpu);
-    void reset_timer();
+    void reset();
+    // Reloads TIMA and raises the interrupt for the overflows due by cpu.clock
+    void update(Cpu& cpu);
+    // Cycles until the next TIMA overflow
+    unsigned int cycles_until_event() const;
+    void map_io(Cpu& cpu);
+
+    uint8_t div() const;
+    uint8_t tima() const;
+    void reset_div();
+    void set_tima(uint8_t v);
+    void set_tac(uint8_t v);
 
 private:
 
-    unsigned int internal_timer;
+    // 16-bit system counter incremented every cycle, DIV is its upper byte.
+    // Not wrapped so that TIMA increments can be counted by dividing it.
+    uint64_t counter() const;
+    // Value of counter() when TIMA overflows
+    uint64_t overflow_counter() const;
+
+    const uint64_t* clock;
 };
 
 #endif //GBEMU_TIMER_HPP
@@ -0,0 +1,30 @@
+#ifndef TIMING_HPP
+#define TIMING_HPP
+
+// When the memory accesses of an instruction happen relative to the
+// peripherals. Cpu is built with one of these (GBEMU_MCYCLE_TIMING), the
+// opcode handlers in cpu_ops.inc are the same for both.
+
+// Every access sees the peripherals as they were when the instruction
+// started, they are advanced by its total cycles once it is done. Lets
+// run() use the JIT and the fused sequences.
+struct BatchedTiming
+{
+    static constexpr bool per_access = false;
+};
+
+// The clock is advanced to the M-cycle of each access before it happens,
+// so that I/O registers are read and written on the cycle they would be
+// on hardware. run() skips the JIT and fusion.
+struct MCycleTiming
+{
+    static constexpr bool per_access = true;
+};
+
+#ifdef GBEMU_MCYCLE_TIMING
+typedef MCycleTiming CpuTiming;
+#else
+typedef BatchedTiming CpuTiming;
+#endif
+
+#endif // TIMING_HPP
@@ -1,5 +1,7 @@
 #include "apu.hpp"
+#include "cpu.hpp"
 #include <cassert>
+#include <algorithm>
 
 // four arrays of 16 elements
 int duty_cycles[4][16] = {
@@ -9,18 +11,50 @@ int duty_cycles[4][16] = {
         { 1, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 1}
 };
 
-Apu::Apu(SDL_AudioDeviceID audio_dev, SDL_AudioSpec audio_spec): pulseA(0), pulseB(1)
+Apu::Apu(SDL_AudioDeviceID audio_dev, SDL_AudioSpec audio_spec)
 {
     this->audio_dev = audio_dev;
     this->audio_spec = audio_spec;
-    elapsed_cycles = 0;
     assert(audio_spec.format == AUDIO_U16);
     assert(audio_spec.channels == 1);
 }
 
+void Apu::map_io(Cpu& cpu)
+{
+    cpu.map_io(0xFF10, &pulseA.sweep);
+    cpu.map_io(0xFF11, &pulseA.length);
+    cpu.map_io(0xFF12, &pulseA.volume);
+    cpu.map_io(0xFF13, &pulseA.frequency);
+    // only bit 6 of NRx4 can be read back, bit 7 triggers the channel
+    cpu.map_io(0xFF14, this, &pulseA.control, nullptr, [](void* ctx, uint8_t v) {
+        Apu* apu = (Apu*)ctx;
+        apu->pulseA.control = (v & 0b01000111) | (apu->pulseA.control & (0b10111000));
+        if (v & (1 << 7)) {
+            apu->sound_on |= FF26_CHANNEL_1_ON_BIT;
+            apu->pulseA.trigger();
+        }
+    }, 0b10111111);
+    cpu.map_io(0xFF16, &pulseB.length);
+    cpu.map_io(0xFF17, &pulseB.volume);
+    cpu.map_io(0xFF18, &pulseB.frequency);
+    cpu.map_io(0xFF19, this, &pulseB.control, nullptr, [](void* ctx, uint8_t v) {
+        Apu* apu = (Apu*)ctx;
+        apu->pulseB.control = (v & 0b01000111) | (apu->pulseB.control & (0b10111000));
+        if (v & (1 << 7)) {
+            apu->sound_on |= FF26_CHANNEL_2_ON_BIT;
+            apu->pulseB.trigger();
+        }
+    }, 0b10111111);
+    // only bit 7 is writable, bits 0-3 are the channel status
+    cpu.map_io(0xFF26, this, &sound_on, nullptr, [](void* ctx, uint8_t v) {
+        Apu* apu = (Apu*)ctx;
+        apu->sound_on = (apu->sound_on & 0b1111) | (v & (1 << 7));
+    });
+}
+
 static float x = 0.f;
 
-void Apu::exec(uint8_t cycles)
+void Apu::exec(unsigned int cycles)
 {
     if ((sound_on & FF26_SOUND_ON_BIT) == 0) {
         return;
@@ -49,6 +83,14 @@ void Apu::exec(uint8_t cycles)
     }
 }
 
+unsigned int Apu::cycles_until_event() const
+{
+    if ((sound_on & FF26_SOUND_ON_BIT) == 0) return ~0u;
+    int cycles = CLOCK_FREQUENCY / audio_spec.freq - elapsed_cycles;
+    cycles = std::min({ cycles, pulseA.cycles_until_event(), pulseB.cycles_until_event() });
+    return cycles > 0 ? cycles : 0;
+}
+
 int Pulse::value() const {
     int duty_id = length >> 6;
     return (duty_cycles[duty_id][duty_step] * gain());
@@ -98,6 +140,16 @@ void Pulse::tick(int cycles, uint8_t &sound_on) {
     }
 }
 
+int Pulse::cycles_until_event() const {
+    int duty_step_frequency = 1048576 / (2048 - wavelength());
+    int cycles = CLOCK_FREQUENCY / duty_step_frequency - elapsed_cycles_duty_step;
+    cycles = std::min(cycles, length_timer.num_cycles - length_timer.current);
+    if (enveloppe_pace) {
+        cycles = std::min(cycles, enveloppe_timer.num_cycles - enveloppe_timer.current);
+    }
+    return cycles;
+}
+
 int Pulse::gain() const {
     return (5000 * current_volume) / 0xf;
 }
@@ -0,0 +1,159 @@
+#include "block_cache.hpp"
+#include "cpu.hpp"
+#include "mbc.hpp"
+#include "fusion.hpp"
+#include <string.h>
+
+static bool ends_block(uint8_t opcode)
+{
+    switch(opcode) {
+        case 0x10: // STOP
+        case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // JR
+        case 0x76: // HALT
+        case 0xc0: case 0xc8: case 0xc9: case 0xd0: case 0xd8: case 0xd9: // RET, RETI
+        case 0xc2: case 0xc3: case 0xca: case 0xd2: case 0xda: case 0xe9: // JP
+        case 0xc4: case 0xcc: case 0xcd: case 0xd4: case 0xdc: // CALL
+        case 0xc7: case 0xcf: case 0xd7: case 0xdf: case 0xe7: case 0xef: case 0xf7: case 0xff: // RST
+        case 0xd3: case 0xdb: case 0xdd: case 0xe3: case 0xe4: case 0xeb: case 0xec: case 0xed: case 0xf4: case 0xfc: case 0xfd: // invalid
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+static unsigned int ram_code_offset(uint16_t a)
+{
+    if (a <= 0xDFFF) return a - 0xC000;
+    if (a <= 0xFDFF) return a - 0xE000;
+    return 0x2000 + a - 0xFF80;
+}
+
+BlockCache::BlockCache()
+{
+    current = nullptr;
+    next_index = 0;
+    next_pc = 0;
+    code_changed = false;
+    memset(ram_code, 0, sizeof(ram_code));
+    memset(ram_code_pages, 0, sizeof(ram_code_pages));
+}
+
+void BlockCache::clear()
+{
+    rom_blocks.clear();
+    flush_ram();
+}
+
+void BlockCache::flush_ram()
+{
+    ram_blocks.clear();
+    memset(ram_code, 0, sizeof(ram_code));
+    memset(ram_code_pages, 0, sizeof(ram_code_pages));
+    current = nullptr;
+    code_changed = true;
+}
+
+const DecodedInstr* BlockCache::fetch(Cpu& cpu)
+{
+    const DecodedInstr* instr = peek(cpu);
+    if (instr) {
+        next_index++;
+        next_pc += instr->length;
+    }
+    return instr;
+}
+
+const DecodedInstr* BlockCache::peek(Cpu& cpu)
+{
+    if (current && cpu.pc == next_pc && next_index < current->instrs.size()) {
+        return &current->instrs[next_index];
+    }
+
+    current = lookup(cpu, cpu.pc);
+    if (!current) return nullptr;
+    next_index = 0;
+    next_pc = cpu.pc;
+    return &current->instrs[0];
+}
+
+Block* BlockCache::enter(Cpu& cpu)
+{
+    if (current && cpu.pc == next_pc && next_index < current->instrs.size()) return nullptr;
+
+    current = lookup(cpu, cpu.pc);
+    next_index = 0;
+    next_pc = cpu.pc;
+    return current;
+}
+
+Block* BlockCache::lookup(Cpu& cpu, uint16_t pc)
+{
+    std::unordered_map<uint32_t, Block>* blocks;
+    uint32_t key;
+    uint16_t region_end;
+
+    if (pc <= 0x3FFF) {
+        blocks = &rom_blocks;
+        key = pc;
+        region_end = 0x4000;
+    } else if (pc <= 0x7FFF) {
+        blocks = &rom_blocks;
+        key = (cpu.mbc->current_rom_bank() << 16) | pc;
+        region_end = 0x8000;
+    } else if (pc >= 0xC000 && pc <= 0xDFFF) {
+        blocks = &ram_blocks;
+        key = pc;
+        region_end = 0xE000;
+    } else if (pc >= 0xE000 && pc <= 0xFDFF) {
+        blocks = &ram_blocks;
+        key = pc;
+        region_end = 0xFE00;
+    } else if (pc >= 0xFF80 && pc <= 0xFFFE) {
+        blocks = &ram_blocks;
+        key = pc;
+        region_end = 0xFFFF;
+    } else {
+        return nullptr;
+    }
+
+    auto it = blocks->find(key);
+    if (it != blocks->end()) return &it->second;
+
+    Block block;
+    block.start = pc;
+    block.entry_count = 0;
+    block.native = nullptr;
+    block.native_cycles = 0;
+    decode_block(cpu, block, region_end);
+    if (block.instrs.empty()) return nullptr; // instruction straddles the region end
+
+    if (blocks == &ram_blocks) {
+        for (uint32_t a = block.start; a < block.end; a++) {
+            ram_code[ram_code_offset(a)] = true;
+            ram_code_pages[ram_code_offset(a) >> 8] = true;
+        }
+        cpu.map_wram();
+    }
+
+    return &blocks->emplace(key, std::move(block)).first->second;
+}
+
+void BlockCache::decode_block(Cpu& cpu, Block& block, uint16_t region_end)
+{
+    uint32_t a = block.start;
+    while (block.instrs.size() < BLOCK_MAX_INSTRS) {
+        DecodedInstr instr;
+        cpu.decode(a, instr);
+        if (a + instr.length > region_end) break;
+
+        block.instrs.push_back(instr);
+        a += instr.length;
+        if (ends_block(instr.opcode) || a == region_end) break;
+    }
+    block.end = a;
+
+    for (size_t i = 0; i < block.instrs.size(); i++) {
+        block.instrs[i].fusion = match_fusion(&block.instrs[i], block.instrs.size() - i);
+    }
+}
@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
+#include <algorithm>
 #include "cpu.hpp"
 #include "mbc.hpp"
 #include "ppu.hpp"
@@ -9,14 +11,32 @@
 #include "opcodes.hpp"
 #include "util.hpp"
 #include "apu.hpp"
-
-
-Cpu::Cpu(): serial(this)
+#include "alu.hpp"
+#include "machine.hpp"
+
+// Hot/cold layout, see CpuState and Cpu
+static_assert(offsetof(CpuState, scheduler) + offsetof(Scheduler, next) + sizeof(uint64_t) <= 64,
+    "registers, clock and next event have to share a cache line");
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winvalid-offsetof"
+static_assert(offsetof(Cpu, skip_idle_loops) < 128, "the per-instruction fields of Cpu have to fit in two cache lines");
+#pragma GCC diagnostic pop
+
+Cpu::Cpu()
 {
     ppu = nullptr;
     mbc = nullptr;
     breakpoint = 0xffff;
+    memset(io, 0, sizeof(io));
     halted = false;
+    use_jit = false;
+    use_fusion = true;
+    lazy_sync = true;
+    instr_elapsed = 0;
+    next_access = 0;
+    skip_idle_loops = true;
+    title[0] = 0;
+    speedhack = nullptr;
     reset();
 
     log_file = fopen("logfile.txt", "wb");
@@ -33,18 +53,25 @@ void Cpu::reset()
     ie = 0;
     if_ = 0xe1;
     ime = true;
-    z = h = c = 1;
-    n = 0;
-    memset(wram, 0, sizeof(wram));
-    memset(hram, 0, sizeof(hram));
+    ime_pending = false;
+    clock = 0;
+    scheduler.reset(clock);
+#ifdef GBEMU_LAZY_FLAGS
+    flag_op = FLAGS_NONE;
+#endif
+    memset(memory.wram, 0, sizeof(memory.wram));
+    memset(memory.hram, 0, sizeof(memory.hram));
     memset(regs, 0, sizeof(regs));
     regs[REG_A] = 0x01;
+    regs[REG_F] = 0xb0;
     regs[REG_C] = 0x13;
     regs[REG_E] = 0xd8;
     regs[REG_H] = 0x01;
     regs[REG_L] = 0x4d;
-    serial = SerialController(this);
+    serial = SerialController();
     if (mbc) mbc->reset();
+    block_cache.clear();
+    map_memory();
 }
 
 Cpu::~Cpu()
@@ -66,12 +93,18 @@ void Cpu::load(const char* path)
     }
 
     assert(cartridge[0x104] == 0xCE && cartridge[0x105] == 0xED);
-    char title[17];
     memcpy(title, cartridge + 0x134, 16);
     title[16] = 0;
 
     puts(title);
 
+    speedhack = find_speedhack(cartridge[0x14d], title);
+    if (speedhack) {
+        printf("Speed hacks (database v%u): %u wait loops, frame skip %u\n", SPEEDHACK_DB_VERSION,
+            speedhack->num_wait_loops, speedhack->frame_skip);
+        ppu->frame_skip = speedhack->frame_skip;
+    }
+
     switch(cartridge[0x147])
     {
         case 0x00:
@@ -104,9 +137,129 @@ void Cpu::load(const char* path)
             exit(1);
     }
     mbc->load(cartridge, size);
+    map_memory();
+}
+
+// Grows the fetch region around addr while the pages are backed by
+// consecutive host memory
+void Cpu::map_fetch(uint16_t addr)
+{
+    unsigned int first = addr >> 8;
+    fetch_start = fetch_end = 0;
+    if (!read_map[first]) return;
+    unsigned int last = first;
+    while (first > 0 && read_map[first - 1] == read_map[first] - 0x100) first--;
+    while (last < 0xff && read_map[last + 1] == read_map[last] + 0x100) last++;
+    fetch_ptr = read_map[first];
+    fetch_start = first << 8;
+    fetch_end = (last + 1) << 8;
+}
+
+void Cpu::map_io(uint16_t a, uint8_t* value, uint8_t read_mask)
+{
+    map_io(a, nullptr, value, nullptr, nullptr, read_mask);
+}
+
+void Cpu::map_io(uint16_t a, void* ctx, uint8_t* value, IoReadFn read, IoWriteFn write, uint8_t read_mask)
+{
+    assert(a >= 0xFF00 && a <= 0xFF7F);
+    IoRegister& r = io[a - 0xFF00];
+    r.value = value;
+    r.read = read;
+    r.write = write;
+    r.ctx = ctx;
+    r.read_mask = read_mask;
+}
+
+void Cpu::map_io_ports()
+{
+    memset(io, 0, sizeof(io));
+    joypad.map_io(*this);
+    serial.map_io(*this);
+    timer->map_io(*this);
+    apu->map_io(*this);
+    ppu->map_io(*this);
+
+    map_io(0xFF0F, this, &if_, nullptr, [](void* ctx, uint8_t v) {
+        ((Cpu*)ctx)->if_ = v | (1 << 5) | (1 << 6) | (1 << 7);
+    });
+    map_io(0xFF46, this, nullptr, nullptr, [](void* ctx, uint8_t v) {
+        Cpu* cpu = (Cpu*)ctx;
+        // bug: the transfer should take 160 cycles
+        for (uint8_t i = 0; i <= 0x9F; i++)
+        {
+            uint16_t a = (v << 8) | i;
+            cpu->ppu->oam[i] = cpu->mem(a);
+        }
+    });
+}
+
+void Cpu::map_memory()
+{
+    fetch_start = fetch_end = 0;
+    memset(read_map, 0, sizeof(read_map));
+    memset(write_map, 0, sizeof(write_map));
+    if (mbc) {
+        for (unsigned int i = 0; i < 0x40; i++) read_map[i] = mbc->rom + i * 0x100;
+        map_cartridge();
+    }
+    if (ppu) map_video();
+    map_wram();
+}
+
+// Only touches the pages whose mapping changed, games write to the MBC a lot
+void Cpu::map_cartridge()
+{
+    uint8_t* bank = mbc->rom + 0x4000 * mbc->current_rom_bank();
+    if (read_map[0x40] != bank) {
+        fetch_start = fetch_end = 0;
+        for (unsigned int i = 0; i < 0x40; i++) read_map[0x40 + i] = bank + i * 0x100;
+    }
+    uint8_t* ram = mbc->ram_ptr();
+    if (read_map[0xa0] != ram) {
+        fetch_start = fetch_end = 0;
+        for (unsigned int i = 0; i < 0x20; i++) {
+            read_map[0xa0 + i] = write_map[0xa0 + i] = ram ? ram + i * 0x100 : nullptr;
+        }
+    }
+}
+
+void Cpu::map_video()
+{
+    uint8_t* vram = ppu->vramaccess() ? ppu->vram : nullptr;
+    if (read_map[0x80] == vram) return;
+    fetch_start = fetch_end = 0;
+    for (unsigned int i = 0; i < 0x20; i++) {
+        read_map[0x80 + i] = write_map[0x80 + i] = vram ? vram + i * 0x100 : nullptr;
+    }
 }
 
-uint8_t Cpu::mem(uint16_t a, bool bypass) const
+// 0xE000-0xFDFF mirrors the first 0x1E00 bytes
+void Cpu::map_wram()
+{
+    for (unsigned int i = 0; i < 0x20; i++) {
+        uint8_t* p = memory.wram + i * 0x100;
+        uint8_t* w = block_cache.ram_page_has_code(i) ? nullptr : p;
+        read_map[0xc0 + i] = p;
+        write_map[0xc0 + i] = w;
+        if (i < 0x1e) {
+            read_map[0xe0 + i] = p;
+            write_map[0xe0 + i] = w;
+        }
+    }
+}
+
+// Peripheral owning the I/O register at 0xFF00 + port, EVENT_SOURCE_COUNT
+// for the ones that do not change with time
+static EventSource io_source(uint8_t port)
+{
+    if (port >= 0x04 && port <= 0x07) return EVENT_TIMER;
+    if (port >= 0x10 && port <= 0x3f) return EVENT_APU;
+    if (port >= 0x40 && port <= 0x4b) return EVENT_PPU;
+    return EVENT_SOURCE_COUNT;
+}
+
+uint8_t Cpu::mem_slow(uint16_t a, bool bypass)
 {
     if (a <= 0x7FFF) return mbc->mem(a);
     if (a <= 0x9FFF) {
@@ -114,8 +267,8 @@ uint8_t Cpu::mem(uint16_t a, bool bypass) const
         return ppu->vram[a - 0x8000];
     }
     if (a <= 0xBFFF) return mbc->mem(a);
-    if (a <= 0xDFFF) return wram[a - 0xC000];
-    if (a <= 0xFDFF) return wram[a - 0xE000];
+    if (a <= 0xDFFF) return memory.wram[a - 0xC000];
+    if (a <= 0xFDFF) return memory.wram[a - 0xE000];
     if (a <= 0xFE9F) {
         if (!bypass && !ppu->oamaccess()) return 0xFF;
         return ppu->oam[a - 0xFE00];
@@ -125,52 +278,26 @@ uint8_t Cpu::mem(uint16_t a, bool bypass) const
         return 0;
     }
     if (a <= 0xFF7F) {
-        switch(a) {
-            case 0xFF00: return joypad.joyp();
-            case 0xFF01: return serial.sb;
-            case 0xFF02: return serial.sc;
-            case 0xFF04: return timer->div;
-            case 0xFF05: return timer->tima;
-            case 0xFF06: return timer->tma;
-            case 0xFF07: return timer->tac;
-            case 0xFF0F: return if_;
-            case 0xFF10: return apu->pulseA.sweep;
-            case 0xFF11: return apu->pulseA.length;
-            case 0xFF12: return apu->pulseA.volume;
-            case 0xFF13: return apu->pulseA.frequency;
-            case 0xFF14: return (apu->pulseA.control & (1 << 6)) | ~(1 << 6);
-            case 0xFF16: return apu->pulseB.length;
-            case 0xFF17: return apu->pulseB.volume;
-            case 0xFF18: return apu->pulseB.frequency;
-            case 0xFF19: return (apu->pulseB.control & (1 << 6)) | ~(1 << 6);
-            case 0xFF26: return apu->sound_on;
-            case 0xFF40: return ppu->lcdc;
-            case 0xFF41: return ppu->stat;
-            case 0xFF42: return ppu->scy;
-            case 0xFF43: return ppu->scx;
-            case 0xFF44: return ppu->ly;
-            case 0xFF45: return ppu->lyc;
-            case 0xFF47: return ppu->bgp;
-            case 0xFF48: return ppu->obp0;
-            case 0xFF49: return ppu->obp1;
-            case 0xFF4A: return ppu->wy;
-            case 0xFF4B: return ppu->wx;
-            default:
-                return 0xFF;
-                fprintf(stderr, "Unsupported I/O read: %04x (pc = %04x)\n", a, pc);
-        }
+        EventSource source = io_source(a & 0xff);
+        if (!bypass && source != EVENT_SOURCE_COUNT) catch_up(source);
+        const IoRegister& r = io[a - 0xFF00];
+        if (r.read) return r.read(r.ctx) | r.read_mask;
+        if (r.value) return *r.value | r.read_mask;
+        return 0xFF;
     }
 
-    if (a <= 0xFFFE) return hram[a - 0xFF80];
+    if (a <= 0xFFFE) return memory.hram[a - 0xFF80];
     return ie;
 }
 
 // return true if break, false otherwise
-bool Cpu::memw(uint16_t a, uint8_t v)
+bool Cpu::memw_slow(uint16_t a, uint8_t v)
 {
     bool b = false;
     if (a <= 0x7FFF) {
         mbc->memw(a, v);
+        map_cartridge();
+        block_cache.bank_switched();
         return b;
     }
     if (a <= 0x9FFF) {
@@ -183,11 +310,15 @@ bool Cpu::memw(uint16_t a, uint8_t v)
         return b;
     }
     if (a <= 0xDFFF) {
-        wram[a - 0xC000] = v;
+        memory.wram[a - 0xC000] = v;
+        block_cache.ram_written(a - 0xC000);
+        if (!block_cache.ram_page_has_code((a - 0xC000) >> 8)) map_wram();
         return b;
     }
     if (a <= 0xFDFF) {
-        wram[a - 0xE000] = v;
+        memory.wram[a - 0xE000] = v;
+        block_cache.ram_written(a - 0xE000);
+        if (!block_cache.ram_page_has_code((a - 0xE000) >> 8)) map_wram();
         return b;
     }
     if (a <= 0xFE9F) {
@@ -198,66 +329,24 @@ bool Cpu::memw(uint16_t a, uint8_t v)
     if (a <= 0xFEFF) return b;
 
     if (a <= 0xFF7F) {
-        switch(a) {
-            case 0xFF00: joypad.select_buttons = (v & (1 << 5)) == 0; break;
-            case 0xFF01: serial.sb = v; printf("%c", v); break;
-            case 0xFF02: serial.sc = v; break;
-            case 0xFF04: timer->reset_timer(); break;
-            case 0xFF05: timer->tima = v; break;
-            case 0xFF06: timer->tma = v; break;
-            case 0xFF07: timer->tac = v | 0b11111000; break;
-            case 0xFF0F: if_ = v | (1 << 5) | (1 << 6) | (1 << 7); break;
-            case 0xFF10: apu->pulseA.sweep = v; break;
-            case 0xFF11: apu->pulseA.length = v; break;
-            case 0xFF12: apu->pulseA.volume = v; break;
-            case 0xFF13: apu->pulseA.frequency = v; break;
-            case 0xFF14:
-                apu->pulseA.control = (v & 0b01000111) | (apu->pulseA.control & (0b10111000));
-                // trigger channel if bit 7 is set
-                if (v & (1 << 7)) {
-                    apu->sound_on |= FF26_CHANNEL_1_ON_BIT;
-                    apu->pulseA.trigger();
-                }
-                break;
-            case 0xFF16: apu->pulseB.length = v; break;
-            case 0xFF17: apu->pulseB.volume = v; break;
-            case 0xFF18: apu->pulseB.frequency = v; break;
-            case 0xFF19:
-                // write to bit 0-2 and 6
-                apu->pulseB.control = (v & 0b01000111) | (apu->pulseB.control & (0b10111000));
-                // trigger channel if bit 7 is set
-                if (v & (1 << 7)) {
-                    apu->sound_on |= FF26_CHANNEL_2_ON_BIT;
-                    apu->pulseB.trigger();
-                }
-                break;
-            case 0xFF26: apu->sound_on = (apu->sound_on & 0b1111) | (v & (1 << 7)); break; // only set bit 7, bits 0-3 are read-only
-            case 0xFF40: ppu->lcdc = v; break;
-            case 0xFF41: ppu->stat = 0b10000000 | (v & 0b01111000) | (ppu->stat & 0b00000111); break;
-            case 0xFF42: ppu->scy = v; break;
-            case 0xFF43: ppu->scx = v; break;
-            case 0xFF45: ppu->lyc = v; break;
-            case 0xFF46:
-                // bug: the transfer should take 160 cycles
-                for (uint8_t i = 0; i <= 0x9F; i++)
-                {
-                    uint16_t a = (v << 8) | i;
-                    ppu->oam[i] = mem(a);
-                }
-                break;
-            case 0xFF47: ppu->bgp = v; break;
-            case 0xFF48: ppu->obp0 = v; break;
-            case 0xFF49: ppu->obp1 = v; break;
-            case 0xFF4A: ppu->wy = v; break;
-            case 0xFF4B: ppu->wx = v; break;
-            default:
-                fprintf(stderr, "Unsupported I/O write: %04x (pc = %04x)\n", a, pc);
+        EventSource source = io_source(a & 0xff);
+        if (source != EVENT_SOURCE_COUNT) catch_up(source);
+        IoRegister& r = io[a - 0xFF00];
+        if (r.write) {
+            r.write(r.ctx, v);
+        } else if (r.value) {
+            *r.value = v;
+        } else {
+            fprintf(stderr, "Unsupported I/O write: %04x (pc = %04x)\n", a, pc);
         }
+        // the write may have moved its next event
+        if (source != EVENT_SOURCE_COUNT && lazy_sync) scheduler.schedule(source, clock + until_event(source));
         return b;
     }
 
     if (a <= 0xFFFE) {
-        hram[a - 0xFF80] = v;
+        memory.hram[a - 0xFF80] = v;
+        block_cache.ram_written(0x2000 + a - 0xFF80);
         return b;
     }
     ie = v;
@@ -265,75 +354,195 @@ bool Cpu::memw(uint16_t a, uint8_t v)
     return b;
 }
 
+// Every push comes after an M-cycle that decrements SP
 void Cpu::push(uint16_t v)
 {
-    sp -= 2;
-    memw(sp, v & 0xFF);
-    memw(sp+1, v >> 8);
+    internal_cycle();
+    // high byte first, one M-cycle each
+    bus_write(--sp, v >> 8);
+    bus_write(--sp, v & 0xFF);
 }
 
 uint8_t Cpu::pop8()
 {
-    uint8_t v = mem(sp);
+    uint8_t v = bus_read(sp);
     sp++;
     return v;
 }
 
 uint16_t Cpu::pop16()
 {
-    uint16_t v = mem(sp) | (mem(sp+1) << 8);
+    uint16_t lo = bus_read(sp);
+    uint16_t v = lo | (bus_read(sp+1) << 8);
     sp += 2;
     return v;
 }
 
 uint16_t Cpu::af()
 {
-    uint8_t f = (c << 4) | (h << 5) | (n << 6) | (z << 7);
-    return (regs[REG_A] << 8) | f;
+    sync_flags();
+    return pairs[PAIR_AF];
+}
+
+void Cpu::decode(uint16_t addr, DecodedInstr& instr)
+{
+    if (addr < fetch_start || addr + 3u > fetch_end) map_fetch(addr);
+    if (addr + 3u <= fetch_end) {
+        const uint8_t* p = fetch_ptr + (addr - fetch_start);
+        instr.opcode = p[0];
+        instr.operand = p[1] | (p[2] << 8);
+    } else {
+        // unmapped, or the instruction may cross into another region
+        instr.opcode = mem(addr);
+        instr.operand = 0;
+        if (g_opcode_info[instr.opcode].length >= 2) instr.operand = mem(addr+1);
+        if (g_opcode_info[instr.opcode].length == 3) instr.operand |= mem(addr+2) << 8;
+    }
+    const OpcodeInfo& info = g_opcode_info[instr.opcode];
+    instr.length = info.length;
+    instr.cycles = info.cycles;
+    instr.fusion = FUSE_NONE;
+    if (instr.length == 1) instr.operand = 0;
+    else if (instr.length == 2) instr.operand &= 0xff;
+    if (instr.opcode == 0xCB) instr.cycles = g_prefix_cycles[instr.operand];
+}
+
+// carry is the carry in for ADC/SBC and the preserved carry for INC/DEC.
+// Without GBEMU_LAZY_FLAGS op is a constant at every call site and this
+// folds down to the usual flag computations.
+inline void Cpu::set_flags(uint8_t op, uint8_t a, uint8_t b, uint8_t res, bool carry)
+{
+#ifdef GBEMU_LAZY_FLAGS
+    flag_op = op;
+    flag_a = a;
+    flag_b = b;
+    flag_res = res;
+    flag_carry = carry;
+#else
+    regs[REG_F] = alu_flags(op, a, b, res, carry);
+#endif
 }
 
-uint16_t Cpu::bc()
+inline bool Cpu::carry_flag() const
 {
-    return regs[REG_C] | (regs[REG_B] << 8);
+#ifdef GBEMU_LAZY_FLAGS
+    if (flag_op != FLAGS_NONE) return alu_c(flag_op, flag_a, flag_b, flag_carry);
+#endif
+    return c();
 }
 
-uint16_t Cpu::de()
+void Cpu::sync_flags()
+{
+#ifdef GBEMU_LAZY_FLAGS
+    if (flag_op == FLAGS_NONE) return;
+    regs[REG_F] = alu_flags(flag_op, flag_a, flag_b, flag_res, flag_carry);
+    flag_op = FLAGS_NONE;
+#endif
+}
+
+#ifdef GBEMU_LAZY_FLAGS
+enum FlagUse : uint8_t {
+    FLAG_USE_NONE,
+    FLAG_USE_Z,
+    FLAG_USE_C,
+    FLAG_USE_ALL
+};
+
+// What each opcode needs from the flags besides going through set_flags()
+static constexpr std::array<uint8_t, 0x100> make_flag_use()
 {
-    return regs[REG_E] | (regs[REG_D] << 8);
+    std::array<uint8_t, 0x100> use{};
+    for (int op = 0; op < 0x100; op++) {
+        uint8_t lo = op & 0xf;
+        if (op < 0x40) {
+            if (lo == 0x1 || lo == 0x2 || lo == 0x3 || lo == 0x6 || lo == 0xa || lo == 0xb || lo == 0xe ||
+                (op & 0xc6) == 0x04 || op == 0x00 || op == 0x08 || op == 0x10 || op == 0x18) {
+                use[op] = FLAG_USE_NONE; // loads, 16-bit INC/DEC, INC/DEC r, NOP, STOP, JR
+            } else if ((op & 0xe7) == 0x20) {
+                use[op] = (op & 0x10) ? FLAG_USE_C : FLAG_USE_Z; // JR cc
+            } else {
+                use[op] = FLAG_USE_ALL;
+            }
+        } else if (op < 0xc0) {
+            use[op] = FLAG_USE_NONE; // LD r,r', HALT, ALU A,r
+        } else if ((op & 0xe7) == 0xc0 || (op & 0xe7) == 0xc2 || (op & 0xe7) == 0xc4) {
+            use[op] = (op & 0x10) ? FLAG_USE_C : FLAG_USE_Z; // RET/JP/CALL cc
+        } else {
+            switch(op) {
+                case 0xc1: case 0xc3: case 0xc5: case 0xc6: case 0xc7: case 0xc9: case 0xcd: case 0xce: case 0xcf:
+                case 0xd1: case 0xd5: case 0xd6: case 0xd7: case 0xd9: case 0xde: case 0xdf:
+                case 0xe0: case 0xe1: case 0xe2: case 0xe5: case 0xe6: case 0xe7: case 0xe9: case 0xea: case 0xee: case 0xef:
+                case 0xf0: case 0xf2: case 0xf3: case 0xf6: case 0xf7: case 0xf9: case 0xfa: case 0xfb: case 0xfe: case 0xff:
+                    use[op] = FLAG_USE_NONE;
+                    break;
+                default:
+                    use[op] = FLAG_USE_ALL; // CB, POP/PUSH AF, ADD SP, LD HL,SP+r
+                    break;
+            }
+        }
+    }
+    return use;
 }
 
-uint16_t Cpu::hl()
+static constexpr std::array<uint8_t, 0x100> flag_use = make_flag_use();
+#endif
+
+// Conditional branches only need one flag, which can be computed without
+// leaving lazy mode. Everything else that reads or writes the flags
+// directly gets all four.
+inline void Cpu::prepare_flags(uint8_t opcode)
 {
-    return regs[REG_L] | (regs[REG_H] << 8);
+#ifdef GBEMU_LAZY_FLAGS
+    if (flag_op == FLAGS_NONE) return;
+    switch(flag_use[opcode]) {
+        case FLAG_USE_Z:
+            set_z(flag_res == 0);
+            break;
+
+        case FLAG_USE_C:
+            set_c(alu_c(flag_op, flag_a, flag_b, flag_carry));
+            break;
+
+        case FLAG_USE_ALL:
+            sync_flags();
+            break;
+    }
+#else
+    (void)opcode;
+#endif
 }
 
 void Cpu::instr_add(uint8_t v)
 {
-    h = (regs[REG_A] & 0xf) + (v & 0xf) > 0xf;
-    c = regs[REG_A] + v > 0xff;
-    regs[REG_A] += v;
-    z = regs[REG_A] == 0;
-    n = 0;
+    uint8_t a = regs[REG_A];
+    regs[REG_A] = a + v;
+    set_flags(FLAGS_ADD, a, v, regs[REG_A], false);
 }
 
 void Cpu::instr_adc(uint8_t v)
 {
-    uint8_t old_c = c;
-    h = ((uint64_t)regs[REG_A] & 0xf) + ((uint64_t)v & 0xf) + ((uint64_t)c & 0xf) > 0xf;
-    c = (uint64_t)regs[REG_A] + (uint64_t)v + (uint64_t)c > 0xff;
-    regs[REG_A] += v + old_c;
-    z = regs[REG_A] == 0;
-    n = 0;
+    uint8_t a = regs[REG_A];
+    bool carry = carry_flag();
+    regs[REG_A] = a + v + carry;
+    set_flags(FLAGS_ADD, a, v, regs[REG_A], carry);
+}
+
+void Cpu::instr_add_hl(uint16_t v)
+{
+    uint16_t a = pairs[PAIR_HL];
+    uint32_t res = a + v;
+    pairs[PAIR_HL] = res;
+    set_n(false);
+    set_h((a & 0xfff) + (v & 0xfff) > 0xfff);
+    set_c(res > 0xffff);
 }
 
 void Cpu::instr_sbc(uint8_t v)
 {
-    uint8_t old_c = c;
-    h = (v & 0xf) + c > (regs[REG_A] & 0xf);
-    c = v + c > regs[REG_A];
-    n = 1;
-    regs[REG_A] -= v + old_c;
-    z = regs[REG_A] == 0;
+    uint8_t a = regs[REG_A];
+    bool carry = carry_flag();
+    regs[REG_A] = a - v - carry;
+    set_flags(FLAGS_SUB, a, v, regs[REG_A], carry);
 }
 
 void Cpu::instr_rst(uint16_t addr)
@@ -344,1933 +553,690 @@ void Cpu::instr_rst(uint16_t addr)
 
 void Cpu::instr_inc8(uint8_t &v)
 {
-    z = (v == 0xff);
-    n = 0;
-    h = ((v & 0x0f) == 0x0f);
+    set_flags(FLAGS_INC, v, 0, v + 1, carry_flag());
     v++;
 }
 
 void Cpu::instr_dec8(uint8_t& v)
 {
-    z = (v == 1);
-    n = 1;
-    h = ((v & 0x0f) == 0);
+    set_flags(FLAGS_DEC, v, 0, v - 1, carry_flag());
     v--;
 }
 
 void Cpu::instr_sub(uint8_t v)
 {
-    c = v > regs[REG_A];
-    h = (v & 0xf) > (regs[REG_A] & 0xf);
-    n = 1;
-    regs[REG_A] -= v;
-    z = regs[REG_A] == 0;
+    uint8_t a = regs[REG_A];
+    regs[REG_A] = a - v;
+    set_flags(FLAGS_SUB, a, v, regs[REG_A], false);
 }
 
 void Cpu::instr_and(uint8_t v)
 {
     regs[REG_A] &= v;
-    z = regs[REG_A] == 0;
-    h = 1;
-    n = c = 0;
+    set_flags(FLAGS_AND, 0, 0, regs[REG_A], false);
 }
 
 void Cpu::instr_xor(uint8_t v)
 {
     regs[REG_A] ^= v;
-    z = (regs[REG_A] == 0);
-    n = h = c = 0;
+    set_flags(FLAGS_OR, 0, 0, regs[REG_A], false);
 }
 
 void Cpu::instr_or(uint8_t v)
 {
     regs[REG_A] |= v;
-    n = c = h = 0;
-    z = regs[REG_A] == 0;
+    set_flags(FLAGS_OR, 0, 0, regs[REG_A], false);
 }
 
 void Cpu::instr_cp(uint8_t v)
 {
-    c = v > regs[REG_A];
-    z = v == regs[REG_A];
-    n = 1;
-    h = (v & 0xF) > (regs[REG_A] & 0xF);
+    set_flags(FLAGS_SUB, regs[REG_A], v, regs[REG_A] - v, false);
+}
+
+// Rotates and shifts, op is bits 3-5 of the CB opcode
+inline void Cpu::instr_shift(uint8_t op, uint8_t& v)
+{
+    const AluResult& r = g_shift[(op << 9) | (c() << 8) | v];
+    v = r.v;
+    regs[REG_F] = r.f;
+}
+
+void Cpu::executeInstruction(const DecodedInstr& instr, SideEffects& eff) {
+
+    eff.cycles = instr.cycles;
+    uint8_t d8 = instr.operand & 0xff;
+    uint16_t d16 = instr.operand;
+    prepare_flags(instr.opcode);
+
+#define OP(opcode) case opcode:
+#define OP_RANGE(first, last, name) case first ... last:
+#define NEXT break
+    switch(instr.opcode) {
+#include "cpu_ops.inc"
+
+        case 0xcb: // PREFIX
+            execPrefix(d8);
+            break;
+
+        default:
+            fprintf(stderr, "Unknown instruction %02x at address %04x\n", instr.opcode, pc-1);
+            exit(1);
+    }
+#undef OP
+#undef OP_RANGE
+#undef NEXT
+
 }
 
-void Cpu::instr_rlc(uint8_t &v)
+// Returns the number of cycles spent, 0 if no interrupt was taken
+inline uint8_t Cpu::serviceInterrupts()
 {
-    c = v >> 7;
-    v <<= 1;
-    v |= c;
-    z = v == 0;
-    n = h = 0;
+    if (((ie & if_ & 0x1f) | ime_pending) == 0) return 0;
+    return dispatch_interrupt();
 }
 
-void Cpu::instr_rrc(uint8_t &v)
+uint8_t Cpu::dispatch_interrupt()
 {
-    c = v & 1;
-    v >>= 1;
-    v |= (c << 7);
-    z = (v == 0);
-    n = h = 0;
+    uint8_t pending = ie & if_ & 0x1f;
+    // EI only takes effect after the instruction that follows it
+    bool enabled = ime;
+    ime |= ime_pending;
+    ime_pending = false;
+
+    if (!pending) return 0;
+    halted = false;
+    if (!enabled) return 0;
+
+    // the lowest bit has the highest priority, VBlank at 0x40 to joypad at 0x60
+    unsigned int i = __builtin_ctz(pending);
+    if_ &= ~(1 << i);
+    ime = false;
+    // two M-cycles before the push
+    begin_instruction(4);
+    push(pc);
+    pc = 0x40 + 8 * i;
+    return 5*4;
 }
 
-void Cpu::instr_rl(uint8_t &v)
+// Runs the fused sequence starting with instr, which has just been
+// fetched from the block cache at pc. Each instruction of the sequence
+// ticks the peripherals and counts towards res like it would in run(), and
+// the sequence is left early if that raises an interrupt, exhausts the
+// budget or hits the breakpoint.
+void Cpu::exec_fused(const DecodedInstr* instr, RunResult& res, unsigned int cycle_budget)
 {
-    uint8_t old_c = c;
-    c = v >> 7;
-    v <<= 1;
-    v |= old_c;
-    z = v == 0;
-    h = n = 0;
+    uint8_t fusion = instr->fusion;
+    uint16_t loop_start = pc;
+    unsigned int count = 0;
+#ifdef GBEMU_FUSION_PROFILE
+    bool sampled = fusion_profile.fired[fusion]++ % FUSION_SAMPLE_RATE == 0;
+    auto start = std::chrono::steady_clock::now();
+#endif
+
+    auto advance = [&]() {
+        pc += instr[count].length;
+#ifdef GBEMU_FUSION_PROFILE
+        fusion_profile.record(instr[count].opcode);
+#endif
+    };
+    auto tick = [&](uint8_t cycles) {
+        elapse(cycles);
+        res.cycles += cycles;
+        res.instructions++;
+        count++;
+    };
+    // Moves the block cache past the next instruction of the sequence
+    // unless the loop has to take over
+    auto next = [&]() {
+        if (res.cycles >= cycle_budget || pc == breakpoint || interrupt_ready()) return false;
+        // anything else means the block was flushed, run() fetches again
+        if (block_cache.fetch(*this) != &instr[count]) return false;
+        advance();
+        return true;
+    };
+    auto jr = [&](bool taken) {
+        const DecodedInstr& jump = instr[count];
+        if (taken) pc += unsigned_to_signed(jump.operand & 0xff);
+        tick(taken ? g_opcode_info[jump.opcode].cycles_taken : jump.cycles);
+    };
+
+    advance();
+    switch(fusion) {
+        case FUSE_COPY:
+            regs[REG_A] = mem(hl());
+            pairs[PAIR_HL]++;
+            tick(instr[0].cycles);
+            if (!next()) break;
+            {
+                // the write may flush the block instr points into
+                uint8_t cycles = instr[1].cycles;
+                memw(de(), regs[REG_A]);
+                tick(cycles);
+            }
+            break;
+
+        case FUSE_DEC_JRNZ:
+            instr_dec8(regs[operand_regs[(instr[0].opcode >> 3) & 7]]);
+            tick(instr[0].cycles);
+            if (!next()) break;
+            prepare_flags(0x20);
+            jr(!z());
+            break;
+
+        case FUSE_POLL_CP:
+        case FUSE_POLL_AND: {
+            uint8_t value = mem(0xff00 + (instr[0].operand & 0xff));
+            regs[REG_A] = value;
+            tick(instr[0].cycles);
+            if (!next()) break;
+            if (fusion == FUSE_POLL_CP) instr_cp(instr[1].operand & 0xff);
+            else instr_and(instr[1].operand & 0xff);
+            tick(instr[1].cycles);
+            if (!next()) break;
+            prepare_flags(instr[2].opcode);
+            jr(instr[2].opcode == 0x20 ? !z() : z());
+            // back at the LDH
+            if (skip_idle_loops && pc == loop_start) skip_idle_loop(instr, value, res, cycle_budget);
+            break;
+        }
+
+        case FUSE_TEST_BC:
+            regs[REG_A] = regs[REG_B];
+            tick(instr[0].cycles);
+            if (!next()) break;
+            instr_or(regs[REG_C]);
+            tick(instr[1].cycles);
+            if (!next()) break;
+            prepare_flags(0x20);
+            jr(!z());
+            break;
+    }
+
+#ifdef GBEMU_FUSION_PROFILE
+    fusion_profile.instrs[fusion] += count;
+    if (sampled) {
+        auto end = std::chrono::steady_clock::now();
+        fusion_profile.sampled_ns[fusion] += std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        fusion_profile.sampled_instrs[fusion] += count;
+    }
+#endif
 }
 
-void Cpu::instr_rr(uint8_t &v)
+// Called with pc back at the start of the poll loop at instr after an
+// iteration that read value. As long as the port still reads value and no
+// peripheral event happens, the next iterations would all do the same:
+// run as many of them as fit before the event at once, so that the
+// timing and the state afterwards are the same as executing them.
+void Cpu::skip_idle_loop(const DecodedInstr* instr, uint8_t value, RunResult& res, unsigned int cycle_budget)
 {
-    uint8_t old_c = c;
-    c = v & 1;
-    v >>= 1;
-    v |= (old_c << 7);
-    z = (v == 0);
-    h = n = 0;
+    uint8_t port = instr[0].operand & 0xff;
+    unsigned int length = instr[0].length + instr[1].length + instr[2].length;
+    uint16_t bank = pc >= 0x4000 && pc < 0x8000 ? mbc->current_rom_bank() : 0;
+    if (!idle_pollable(port) && !(speedhack && speedhack->has_wait_loop(bank, pc))) return;
+    if (res.cycles >= cycle_budget || interrupt_ready()) return;
+    if ((uint16_t)(breakpoint - pc) < length || mem(0xff00 + port) != value) return;
+
+    unsigned int iteration = instr[0].cycles + instr[1].cycles + g_opcode_info[instr[2].opcode].cycles_taken;
+    unsigned int n = std::min(cycles_until_event(), cycle_budget - res.cycles) / iteration;
+    if (n == 0) return;
+
+    unsigned int cycles = n * iteration;
+    elapse(cycles);
+    res.cycles += cycles;
+    res.instructions += 3 * n;
+
+    idle_loops.record(pc, bank, instr->fusion, port, cycles);
 }
 
-void Cpu::instr_sla(uint8_t &v)
+// Cycles until the next state change of the peripheral, counted from the
+// clock it is synced to
+unsigned int Cpu::until_event(EventSource source) const
 {
-    c = v >> 7;
-    v <<= 1;
-    z = (v == 0);
-    h = n = 0;
+    switch(source) {
+        case EVENT_TIMER: return timer->cycles_until_event();
+        case EVENT_PPU: return ppu->cycles_until_event();
+        default: return apu->cycles_until_event();
+    }
 }
 
-void Cpu::instr_swap(uint8_t& v)
+unsigned int Cpu::peripherals_until_event() const
 {
-    v = (v << 4) | (v >> 4);
-    z = (v == 0);
-    c = h = n = 0;
+    return std::min({ until_event(EVENT_TIMER), until_event(EVENT_PPU), until_event(EVENT_APU) });
 }
 
-void Cpu::instr_srl(uint8_t& v)
+unsigned int Cpu::cycles_until_event() const
 {
-    c = v & 1;
-    v >>= 1;
-    z = (v == 0);
-    h = n = 0;
+    if (scheduler.all_synced(clock)) return peripherals_until_event();
+    // only lazy_sync leaves some behind, and then the scheduler is current
+    return scheduler.next - clock;
 }
 
-void Cpu::instr_sra(uint8_t &v)
+// No event of the peripheral can be due before clock, so its deadline
+// stays valid
+void Cpu::catch_up(EventSource source)
 {
-    c = v & 1;
-    uint8_t b7 = v & (1 << 7);
-    v >>= 1;
-    v |= b7;
-    z = (v == 0);
-    h = n = 0;
+    unsigned int cycles = clock - scheduler.synced[source];
+    if (cycles == 0) return;
+    switch(source) {
+        case EVENT_TIMER: timer->update(*this); break;
+        case EVENT_PPU: ppu->exec(*this, cycles); break;
+        default: apu->exec(cycles); break;
+    }
+    scheduler.synced[source] = clock;
 }
 
-void Cpu::executeInstruction(uint8_t instr, SideEffects& eff) {
+void Cpu::catch_up_all()
+{
+    for (unsigned int i = 0; i < EVENT_SOURCE_COUNT; i++) catch_up((EventSource)i);
+}
 
-    Opcode opcode = g_opcode_table[instr];
-    eff.cycles = opcode.cycles;
+// All the peripherals must be up to date
+void Cpu::schedule_all()
+{
+    for (unsigned int i = 0; i < EVENT_SOURCE_COUNT; i++) {
+        scheduler.deadline[i] = lazy_sync ? clock + until_event((EventSource)i) : clock;
+    }
+    scheduler.update_next();
+}
 
-    switch(instr) {
-        case 0x00: // NOP
-            break;
+// Ticks the peripherals whose event is due and schedules their next one
+void Cpu::sync()
+{
+    if (!lazy_sync) {
+        catch_up_all();
+        scheduler.next = clock;
+        return;
+    }
+    for (unsigned int i = 0; i < EVENT_SOURCE_COUNT; i++) {
+        if (scheduler.deadline[i] > clock) continue;
+        catch_up((EventSource)i);
+        scheduler.deadline[i] = clock + until_event((EventSource)i);
+    }
+    scheduler.update_next();
+}
 
-        case 0x01: // LD BC, d16
-            regs[REG_C] = mem(pc++);
-            regs[REG_B] = mem(pc++);
-            break;
+// HALT can only end with an interrupt, and only the peripherals raise
+// them: skip to the next event of any of them in one step. Rounded up to a
+// multiple of 4 like instruction timings so that each one still sees its
+// event on the same cycle as with 4-cycle steps.
+unsigned int Cpu::halt_cycles(unsigned int limit) const
+{
+    unsigned int cycles = std::min(cycles_until_event(), limit);
+    cycles = (cycles + 3) & ~3u;
+    return cycles < 4 ? 4 : cycles;
+}
 
-        case 0x02: // LD (BC), A
-            memw(bc(), regs[REG_A]);
-            break;
+SideEffects Cpu::step(unsigned int halt_limit)
+{
+    SideEffects eff{};
+    eff.cycles = serviceInterrupts();
+    eff.break_ = false;
 
-        case 0x03: // INC BC
-        {
-            uint16_t v = bc()+1;
-            regs[REG_B] = v >> 8;
-            regs[REG_C] = v & 0xff;
-            break;
+    if (eff.cycles == 0) {
+        if (halted) {
+            eff.cycles = halt_cycles(halt_limit);
+        } else if (use_jit && !CpuTiming::per_access && (eff.cycles = jit.exec(*this)) != 0) {
+            // ran a compiled block
+        } else {
+            //fprintf(log_file, "A: %02x B: %02x C: %02x D: %02x E: %02x H: %02x L: %02x F: %02x PC: %04x (%02x %02x %02x) LY: %02x\n", regs[REG_A], regs[REG_B], regs[REG_C], regs[REG_D], regs[REG_E], regs[REG_H], regs[REG_L], af() & 0xff, pc, mem(pc), mem(pc+1), mem(pc+2), ppu->ly);
+            DecodedInstr instr;
+            const DecodedInstr* cached = block_cache.fetch(*this);
+            if (cached) {
+                instr = *cached;
+            } else {
+                decode(pc, instr);
+            }
+            pc += instr.length;
+#ifdef GBEMU_FUSION_PROFILE
+            fusion_profile.record(instr.opcode);
+#endif
+            begin_instruction(4 * instr.length);
+            executeInstruction(instr, eff);
         }
+    }
 
-        case 0x04: // INC B
-            instr_inc8(regs[REG_B]);
-            break;
+    assert(eff.cycles > 0);
 
-        case 0x05: // DEC B
-            instr_dec8(regs[REG_B]);
-            break;
+    // serial.exec(eff.cycles, if_);
 
-        case 0x06: // LD B,d8
-            regs[REG_B] = mem(pc++);
-            break;
+    if (pc == breakpoint) eff.break_ = true;
+    return eff;
+}
 
-        case 0x07: // RLCA
-            c = (regs[REG_A] & (1 << 7)) > 0;
-            regs[REG_A] <<= 1;
-            regs[REG_A] |= c;
-            z = n = h = 0;
-            break;
+void Cpu::save(Machine& m)
+{
+    m.cpu = *this;
+    m.cpu_memory = memory;
+    m.ppu = *ppu;
+    m.timer = *timer;
+    m.apu = *apu;
+    m.mbc = *mbc;
+}
 
+// Rebuilds what is derived from the state: the page tables and the code
+// decoded from RAM. ROM blocks are keyed by bank and stay valid whatever
+// the banks of m, so restoring keeps them and their compiled code.
+void Cpu::restore(const Machine& m)
+{
+    static_cast<CpuState&>(*this) = m.cpu;
+    memory = m.cpu_memory;
+    static_cast<PpuState&>(*ppu) = m.ppu;
+    static_cast<TimerState&>(*timer) = m.timer;
+    static_cast<ApuState&>(*apu) = m.apu;
+    static_cast<MbcState&>(*mbc) = m.mbc;
+    block_cache.flush_ram();
+    map_memory();
+}
 
-        case 0x08: // LD (a16),SP
-        {
-            uint16_t a16 = mem(pc) | (mem(pc+1) << 8);
-            memw(a16, sp & 0xff);
-            memw(a16+1, sp >> 8);
-            pc += 2;
-            break;
-        }
+RunResult Cpu::run_steps(uint64_t steps)
+{
+    RunResult res{};
+    schedule_all();
+    for (uint64_t i = 0; i < steps; i++) {
+        SideEffects eff = step(~0u);
+        finish_instruction(eff.cycles);
+        res.cycles += eff.cycles;
+        res.instructions++;
+    }
+    catch_up_all();
+    return res;
+}
 
-        case 0x09: // ADD HL,BC
-        {
-            c = (uint64_t)hl() + (uint64_t)bc() > 0xffff;
-            h = (hl() & 0xfff) + (bc() & 0xfff) > 0xfff;
-            uint16_t v = hl() + bc();
-            regs[REG_L] = v & 0xff;
-            regs[REG_H] = v >> 8;
-            n = 0;
-            break;
-        }
+#ifdef GBEMU_THREADED_DISPATCH
+#define OP_ROW(h) &&op_0x##h##0, &&op_0x##h##1, &&op_0x##h##2, &&op_0x##h##3, \
+                  &&op_0x##h##4, &&op_0x##h##5, &&op_0x##h##6, &&op_0x##h##7, \
+                  &&op_0x##h##8, &&op_0x##h##9, &&op_0x##h##a, &&op_0x##h##b, \
+                  &&op_0x##h##c, &&op_0x##h##d, &&op_0x##h##e, &&op_0x##h##f
+#define OP_SPAN(name) &&op_##name, &&op_##name, &&op_##name, &&op_##name, \
+                      &&op_##name, &&op_##name, &&op_##name, &&op_##name, \
+                      &&op_##name, &&op_##name, &&op_##name, &&op_##name, \
+                      &&op_##name, &&op_##name, &&op_##name, &&op_##name
+
+// Same semantics as calling step() in a loop, but each handler jumps
+// directly to the next one through a label table instead of going back
+// through the switch.
+RunResult Cpu::run(unsigned int cycle_budget)
+{
+    static void* const dispatch[0x100] = {
+        OP_ROW(0), OP_ROW(1), OP_ROW(2), OP_ROW(3),
+        OP_SPAN(block), OP_SPAN(block), OP_SPAN(block), OP_SPAN(block),
+        OP_SPAN(block), OP_SPAN(block), OP_SPAN(block), OP_SPAN(block),
+        OP_ROW(c), OP_ROW(d), OP_ROW(e), OP_ROW(f),
+    };
+
+    RunResult res{};
+    SideEffects eff{};
+    DecodedInstr instr;
+    uint8_t d8;
+    uint16_t d16;
+#ifdef GBEMU_FUSION_PROFILE
+    FusionRunTimer run_timer(fusion_profile);
+#endif
+    // lazy_sync may have changed since the last call
+    schedule_all();
+
+fetch:
+    eff.cycles = serviceInterrupts();
+    if (eff.cycles != 0) goto next;
+    if (halted) {
+        eff.cycles = halt_cycles(cycle_budget - res.cycles);
+        goto next;
+    }
+    if (use_jit && !CpuTiming::per_access && (eff.cycles = jit.exec(*this)) != 0) goto next;
 
-        case 0x0a: // LD A,(BC)
-            regs[REG_A] = mem(bc());
-            break;
+    {
+        const DecodedInstr* cached = block_cache.fetch(*this);
+        if (cached) {
+            if (cached->fusion != FUSE_NONE && use_fusion && !CpuTiming::per_access) {
+                exec_fused(cached, res, cycle_budget);
+                goto check;
+            }
+            instr = *cached;
+        } else {
+            decode(pc, instr);
+        }
+    }
+    pc += instr.length;
+#ifdef GBEMU_FUSION_PROFILE
+    fusion_profile.record(instr.opcode);
+#endif
+    eff.cycles = instr.cycles;
+    d8 = instr.operand & 0xff;
+    d16 = instr.operand;
+    prepare_flags(instr.opcode);
+    begin_instruction(4 * instr.length);
+    goto *dispatch[instr.opcode];
+
+#define OP(opcode) op_##opcode:
+#define OP_RANGE(first, last, name) op_##name:
+#define NEXT goto next
+#include "cpu_ops.inc"
+
+    op_0xcb: // PREFIX
+        prefix_handlers[d8](*this);
+        NEXT;
+#undef OP
+#undef OP_RANGE
+#undef NEXT
+
+    op_0xd3: op_0xdb: op_0xdd: op_0xe3: op_0xe4: op_0xeb:
+    op_0xec: op_0xed: op_0xf4: op_0xfc: op_0xfd:
+        fprintf(stderr, "Unknown instruction %02x at address %04x\n", instr.opcode, pc-1);
+        exit(1);
 
-        case 0x0b: // DEC BC
-        {
-            uint16_t v = bc()-1;
-            regs[REG_B] = v >> 8;
-            regs[REG_C] = v & 0xFF;
-            break;
+next:
+    assert(eff.cycles > 0);
+    finish_instruction(eff.cycles);
+    res.cycles += eff.cycles;
+    res.instructions++;
+
+check:
+    if (pc == breakpoint) {
+        res.break_ = true;
+    } else if (res.cycles < cycle_budget) {
+        goto fetch;
+    }
+    catch_up_all();
+    return res;
+}
+#undef OP_ROW
+#undef OP_SPAN
+#else
+RunResult Cpu::run(unsigned int cycle_budget)
+{
+    RunResult res{};
+#ifdef GBEMU_FUSION_PROFILE
+    FusionRunTimer run_timer(fusion_profile);
+#endif
+    // lazy_sync may have changed since the last call
+    schedule_all();
+
+    while (res.cycles < cycle_budget) {
+        // same checks as step() before it fetches
+        if (use_fusion && !CpuTiming::per_access && !use_jit && !halted && !ime_pending && !interrupt_ready()) {
+            const DecodedInstr* instr = block_cache.peek(*this);
+            if (instr && instr->fusion != FUSE_NONE) {
+                block_cache.fetch(*this);
+                exec_fused(instr, res, cycle_budget);
+                if (pc == breakpoint) {
+                    res.break_ = true;
+                    break;
+                }
+                continue;
+            }
         }
 
+        SideEffects eff = step(cycle_budget - res.cycles);
+        finish_instruction(eff.cycles);
+        res.cycles += eff.cycles;
+        res.instructions++;
 
-        case 0x0c: // INC C
-            instr_inc8(regs[REG_C]);
+        if (eff.break_) {
+            res.break_ = true;
             break;
+        }
+    }
 
-        case 0x0d: // DEC C
-            instr_dec8(regs[REG_C]);
-            break;
+    catch_up_all();
+    return res;
+}
+#endif
 
-        case 0x0e: // LD C,d8
-            regs[REG_C] = mem(pc++);
-            break;
+template<uint8_t r>
+uint8_t Cpu::read_operand()
+{
+    if constexpr (r == 6) {
+        return bus_read(hl());
+    } else {
+        return regs[operand_regs[r]];
+    }
+}
 
-        case 0x0f: // RRCA
-            instr_rrc(regs[REG_A]);
-            z = 0;
-            break;
+template<uint8_t r>
+void Cpu::write_operand(uint8_t v)
+{
+    if constexpr (r == 6) {
+        bus_write(hl(), v);
+    } else {
+        regs[operand_regs[r]] = v;
+    }
+}
 
-        case 0x10: // STOP
-            pc++;
-            break;
-            // TODO: wait for interrupt
+// 0x40-0xbf: LD r,r' (0x76 is HALT) and ALU A,r
+template<uint8_t opcode>
+void Cpu::op_block(Cpu& cpu)
+{
+    constexpr uint8_t y = (opcode >> 3) & 7;
+    constexpr uint8_t r = opcode & 7;
+
+    if constexpr (opcode == 0x76) {
+        cpu.halted = true;
+    } else if constexpr (opcode < 0x80) {
+        if constexpr (y != r) cpu.write_operand<y>(cpu.read_operand<r>());
+    } else {
+        uint8_t v = cpu.read_operand<r>();
+        switch(y) {
+            case 0: cpu.instr_add(v); break;
+            case 1: cpu.instr_adc(v); break;
+            case 2: cpu.instr_sub(v); break;
+            case 3: cpu.instr_sbc(v); break;
+            case 4: cpu.instr_and(v); break;
+            case 5: cpu.instr_xor(v); break;
+            case 6: cpu.instr_or(v); break;
+            case 7: cpu.instr_cp(v); break;
+        }
+    }
+}
 
-        case 0x11: // LD DE,d16
-            regs[REG_E] = mem(pc++);
-            regs[REG_D] = mem(pc++);
-            break;
+// CB page: rotates/shifts/SWAP, BIT, RES, SET
+template<uint8_t cb>
+void Cpu::op_prefix(Cpu& cpu)
+{
+    constexpr uint8_t y = (cb >> 3) & 7;
+    constexpr uint8_t r = cb & 7;
+
+    if constexpr (cb >= 0xc0) {
+        cpu.write_operand<r>(cpu.read_operand<r>() | (1 << y));
+    } else if constexpr (cb >= 0x80) {
+        cpu.write_operand<r>(cpu.read_operand<r>() & ~(1 << y));
+    } else if constexpr (cb >= 0x40) {
+        uint8_t z = (cpu.read_operand<r>() & (1 << y)) ? 0 : FLAG_Z;
+        cpu.regs[REG_F] = (cpu.regs[REG_F] & FLAG_C) | FLAG_H | z;
+    } else if constexpr (r == 6) {
+        uint8_t v = cpu.read_operand<r>();
+        cpu.instr_shift(y, v);
+        cpu.write_operand<r>(v);
+    } else {
+        cpu.instr_shift(y, cpu.regs[operand_regs[r]]);
+    }
+}
 
-        case 0x12: // LD (DE),A
-            memw(de(), regs[REG_A]);
-            break;
+template<size_t... I>
+constexpr std::array<Cpu::OpHandler, sizeof...(I)> Cpu::block_table(std::index_sequence<I...>)
+{
+    return {{ &Cpu::op_block<0x40 + I>... }};
+}
 
-        case 0x13: // INC DE
-        {
-            uint16_t v = de() + 1;
-            regs[REG_E] = v & 0xff;
-            regs[REG_D] = v >> 8;
-            break;
-        }
+template<size_t... I>
+constexpr std::array<Cpu::OpHandler, sizeof...(I)> Cpu::prefix_table(std::index_sequence<I...>)
+{
+    return {{ &Cpu::op_prefix<I>... }};
+}
 
-        case 0x14: // INC D
-            instr_inc8(regs[REG_D]);
-            break;
+const std::array<Cpu::OpHandler, 0x80> Cpu::block_handlers = Cpu::block_table(std::make_index_sequence<0x80>());
+const std::array<Cpu::OpHandler, 0x100> Cpu::prefix_handlers = Cpu::prefix_table(std::make_index_sequence<0x100>());
 
-        case 0x15: // DEC D
-            instr_dec8(regs[REG_D]);
-            break;
+void Cpu::execPrefix(uint8_t cb)
+{
+    prefix_handlers[cb](*this);
+}
 
-        case 0x16: // LD D,d8
-            regs[REG_D] = mem(pc++);
-            break;
 
-        case 0x17: // RLA
-        {
-            instr_rl(regs[REG_A]);
-            z = 0;
-            break;
-        }
+// Stolen from SameBoy
+void Cpu::daa()
+{
+    const AluResult& r = g_daa[(((regs[REG_F] >> 4) & 7) << 8) | regs[REG_A]];
+    regs[REG_A] = r.v;
+    regs[REG_F] = r.f;
+}
 
-        case 0x1A: // LD A,(DE)
-            regs[REG_A] = mem(de());
-            break;
+SerialController::SerialController()
+{
+    remaining = 0;
+    remaining_bits = 0;
+    sb = 0;
+    sc = 0x7e;
+}
 
-        case 0x18: // JR r8
-            pc += unsigned_to_signed(mem(pc))+1;
-            break;
+void SerialController::map_io(Cpu& cpu)
+{
+    cpu.map_io(0xFF01, this, &sb, nullptr, [](void* ctx, uint8_t v) {
+        ((SerialController*)ctx)->sb = v;
+        printf("%c", v);
+    });
+    cpu.map_io(0xFF02, &sc);
+}
 
-        case 0x19: // ADD HL,DE
-        {
-            c = (uint64_t)hl() + (uint64_t)de() > 0xffff;
-            h = (hl() & 0xfff) + (de() & 0xfff) > 0xfff;
-            uint16_t v = hl() + de();
-            regs[REG_L] = v & 0xff;
-            regs[REG_H] = v >> 8;
-            n = 0;
-            break;
+void SerialController::exec(uint8_t cycles, uint8_t& if_)
+{
+    // TODO: external clock, clock speeds
+    if ((sc & (1 << 7)) > 0) {
+        if (remaining_bits == 0) { // begin transfer
+            remaining_bits = 8;
         }
+        remaining -= cycles;
+        if (remaining <= 0) { // send a bit
+            remaining = 512;
+            remaining_bits--;
 
-        case 0x1b: // DEC DE
-        {
-            uint16_t v = de() - 1;
-            regs[REG_E] = v & 0xff;
-            regs[REG_D] = v >> 8;
-            break;
-        }
+            sb <<= 1; // receive a 0
 
-        case 0x1c: // INC E
-            instr_inc8(regs[REG_E]);
-            break;
+            if (remaining_bits == 0) { // end transfer
+                sc &= ~(1 << 7);
+                if_ |= (1 << 3);
+            }
+        }
+    }
+}
 
-        case 0x1d: // DEC E
-            instr_dec8(regs[REG_E]);
-            break;
 
-        case 0x1e: // LD E,d8
-            regs[REG_E] = mem(pc++);
-            break;
+JoypadController::JoypadController()
+{
+    select_buttons = true;
+    buttons_state = 0b11011111;
+    directions_state = 0b11101111;
+}
 
-        case 0x1f: // RRA
-        {
-            uint8_t tmp = c;
-            c = regs[REG_A] & 1;
-            regs[REG_A] >>= 1;
-            regs[REG_A] |= (tmp << 7);
-            z = n = h = 0;
-            break;
-        }
-
-        case 0x20: // JR NZ,r8
-            if (!z) {
-                pc += unsigned_to_signed(mem(pc))+1;
-                eff.cycles = 12;
-            } else {
-                pc++;
-                eff.cycles = 8;
-            }
-            break;
-
-        case 0x21: // LD HL,d16
-            regs[REG_L] = mem(pc++);
-            regs[REG_H] = mem(pc++);
-            break;
-
-        case 0x22: // LD (HL+),A
-        {
-            memw(hl(), regs[REG_A]);
-            uint16_t v = hl()+1;
-            regs[REG_L] = v & 0xff;
-            regs[REG_H] = v >> 8;
-            break;
-        }
-
-        case 0x23: // INC HL
-        {
-            uint16_t v = hl()+1;
-            regs[REG_L] = v & 0xff;
-            regs[REG_H] = v >> 8;
-            break;
-        }
-
-        case 0x24: // INC H
-            instr_inc8(regs[REG_H]);
-            break;
-
-        case 0x25: // DEC H
-            instr_dec8(regs[REG_H]);
-            break;
-
-
-        case 0x26: // LD H,d8
-            regs[REG_H] = mem(pc++);
-            break;
-
-        case 0x27: // DAA
-            daa();
-            break;
-
-        case 0x28: // JR Z,r8
-            if (z) {
-                pc += unsigned_to_signed(mem(pc))+1;
-                eff.cycles = 12;
-            } else {
-                pc++;
-                eff.cycles = 8;
-            }
-            break;
-
-        case 0x29: // ADD HL,HL
-        {
-            c = (uint64_t)hl() + (uint64_t)hl() > 0xffff;
-            h = (hl() & 0xfff) + (hl() & 0xfff) > 0xfff;
-            uint16_t v = hl() + hl();
-            regs[REG_L] = v & 0xff;
-            regs[REG_H] = v >> 8;
-            n = 0;
-            break;
-        }
-
-        case 0x2a: // LD A,(HL+)
-        {
-            regs[REG_A] = mem(hl());
-            uint16_t v = hl()+1;
-            regs[REG_L] = v & 0xFF;
-            regs[REG_H] = v >> 8;
-            break;
-        }
-
-        case 0x2b: // DEC HL
-        {
-            uint16_t v = hl()-1;
-            regs[REG_L] = v & 0xff;
-            regs[REG_H] = v >> 8;
-            break;
-        }
-
-        case 0x2c: // INC L
-            instr_inc8(regs[REG_L]);
-            break;
-
-        case 0x2d: // DEC L
-            instr_dec8(regs[REG_L]);
-            break;
-
-        case 0x2e: // LD L,d8
-            regs[REG_L] = mem(pc++);
-            break;
-
-        case 0x2f: // CPL
-            regs[REG_A] ^= 0xff;
-            n = 1;
-            h = 1;
-            break;
-
-        case 0x30: // JR NC,r8
-            if (!c) {
-                pc += unsigned_to_signed(mem(pc))+1;
-                eff.cycles = 12;
-            } else {
-                pc++;
-                eff.cycles = 8;
-            }
-            break;
-
-        case 0x31: // LD SP,d16
-            sp = mem(pc) | (mem(pc+1) << 8);
-            pc += 2;
-            break;
-
-
-        case 0x32: // LDD (HL),A
-        {
-            memw(hl(), regs[REG_A]);
-            uint16_t v = hl()-1;
-            regs[REG_L] = v & 0xFF;
-            regs[REG_H] = v >> 8;
-            break;
-        }
-
-        case 0x33: // INC SP
-            sp++;
-            break;
-
-        case 0x34: // INC (HL)
-        {
-            uint8_t v = mem(hl());
-            z = v == 0xff;
-            h = ((v & 0xf) == 0xf);
-            n = 0;
-            memw(hl(), v+1);
-            break;
-        }
-
-        case 0x35: // DEC (HL)
-        {
-            uint8_t v = mem(hl());
-            z = v == 1;
-            h = (v & 0xF) == 0;
-            n = 1;
-            memw(hl(), v-1);
-            break;
-        }
-
-        case 0x36: // LD (HL),d8
-            memw(hl(), mem(pc++));
-            break;
-
-        case 0x37: // SCF
-            c = 1;
-            n = 0;
-            h = 0;
-            break;
-
-
-        case 0x38: // JR C,r8
-            if (c) {
-                pc += unsigned_to_signed(mem(pc))+1;
-                eff.cycles = 12;
-            } else {
-                pc++;
-                eff.cycles = 8;
-            }
-            break;
-
-        case 0x39: // ADD HL,SP
-        {
-            c = (uint64_t)hl() + (uint64_t)sp > 0xffff;
-            h = (hl() & 0xfff) + (sp & 0xfff) > 0xfff;
-            uint16_t v = hl() + sp;
-            regs[REG_L] = v & 0xff;
-            regs[REG_H] = v >> 8;
-            n = 0;
-            break;
-        }
-
-
-        case 0x3a: // LD A,(HL-)
-        {
-            regs[REG_A] = mem(hl());
-            uint16_t v = hl()-1;
-            regs[REG_L] = v & 0xff;
-            regs[REG_H] = v >> 8;
-            break;
-        }
-
-        case 0x3b: // DEC SP
-            sp--;
-            break;
-
-        case 0x3c: // INC A
-            instr_inc8(regs[REG_A]);
-            break;
-
-        case 0x3d: // DEC A
-            instr_dec8(regs[REG_A]);
-            break;
-
-        case 0x3e: // LD A,d8
-            regs[REG_A] = mem(pc++);
-            break;
-
-        case 0x3f: // CCF
-            c = !c;
-            n = 0;
-            h = 0;
-            break;
-
-        case 0x40: // LD B,B
-            break;
-
-        case 0x41: // LD B,C
-            regs[REG_B] = regs[REG_C];
-            break;
-
-        case 0x42: // LD B,D
-            regs[REG_B] = regs[REG_D];
-            break;
-
-        case 0x43: // LD B,E
-            regs[REG_B] = regs[REG_E];
-            break;
-
-        case 0x44: // LD B,H
-            regs[REG_B] = regs[REG_H];
-            break;
-
-        case 0x45: // LD B,L
-            regs[REG_B] = regs[REG_L];
-            break;
-
-        case 0x46: // LD B,(HL)
-            regs[REG_B] = mem(hl());
-            break;
-
-        case 0x47: // LD B,A
-            regs[REG_B] = regs[REG_A];
-            break;
-
-        case 0x48: // LD C,B
-            regs[REG_C] = regs[REG_B];
-            break;
-
-        case 0x49: // LD C,C
-            break;
-
-        case 0x4a: // LD C,D
-            regs[REG_C] = regs[REG_D];
-            break;
-
-        case 0x4b: // LD C,E
-            regs[REG_C] = regs[REG_E];
-            break;
-
-        case 0x4c: // LD C,H
-            regs[REG_C] = regs[REG_H];
-            break;
-
-        case 0x4d: // LD C,L
-            regs[REG_C] = regs[REG_L];
-            break;
-
-        case 0x4e: // LD C,(HL)
-            regs[REG_C] = mem(hl());
-            break;
-
-        case 0x4f: // LD C,A
-            regs[REG_C] = regs[REG_A];
-            break;
-
-        case 0x50: // LD D,B
-            regs[REG_D] = regs[REG_B];
-            break;
-
-        case 0x51: // LD D,C
-            regs[REG_D] = regs[REG_C];
-            break;
-
-        case 0x52: // LD D,D
-            break;
-
-        case 0x53: // LD D,E
-            regs[REG_D] = regs[REG_E];
-            break;
-
-        case 0x54: // LD D,H
-            regs[REG_D] = regs[REG_H];
-            break;
-
-        case 0x55: // LD D,L
-            regs[REG_D] = regs[REG_L];
-            break;
-
-        case 0x56: // LD D,(HL)
-            regs[REG_D] = mem(hl());
-            break;
-
-        case 0x57: // LD D,A
-            regs[REG_D] = regs[REG_A];
-            break;
-
-        case 0x58: // LD E,B
-            regs[REG_E] = regs[REG_B];
-            break;
-
-        case 0x59: // LD E,C
-            regs[REG_E] = regs[REG_C];
-            break;
-
-        case 0x5a: // LD E,D
-            regs[REG_E] = regs[REG_D];
-            break;
-
-        case 0x5b: // LD E,E
-            break;
-
-        case 0x5c: // LD E,H
-            regs[REG_E] = regs[REG_H];
-            break;
-
-        case 0x5d: // LD E,L
-            regs[REG_E] = regs[REG_L];
-            break;
-
-        case 0x5e: // LD E,(HL)
-            regs[REG_E] = mem(hl());
-            break;
-
-        case 0x5f: // LD E,A
-            regs[REG_E] = regs[REG_A];
-            break;
-
-        case 0x60: // LD H,B
-            regs[REG_H] = regs[REG_B];
-            break;
-
-        case 0x61: // LD H,C
-            regs[REG_H] = regs[REG_C];
-            break;
-
-        case 0x62: // LD H,D
-            regs[REG_H] = regs[REG_D];
-            break;
-
-        case 0x63: // LD H,E
-            regs[REG_H] = regs[REG_E];
-            break;
-
-        case 0x64: // LD H,H
-            break;
-
-        case 0x65: // LD H,L
-            regs[REG_H] = regs[REG_L];
-            break;
-
-        case 0x66: // LD H,(HL)
-            regs[REG_H] = mem(hl());
-            break;
-
-        case 0x67: // LD H,A
-            regs[REG_H] = regs[REG_A];
-            break;
-
-        case 0x68: // LD L,B
-            regs[REG_L] = regs[REG_B];
-            break;
-
-        case 0x69: // LD L,C
-            regs[REG_L] = regs[REG_C];
-            break;
-
-        case 0x6a: // LD L,D
-            regs[REG_L] = regs[REG_D];
-            break;
-
-        case 0x6b: // LD L,E
-            regs[REG_L] = regs[REG_E];
-            break;
-
-        case 0x6c: // LD L,H
-            regs[REG_L] = regs[REG_H];
-            break;
-
-        case 0x6d: // LD L,L
-            break;
-
-        case 0x6e: // LD L,(HL)
-            regs[REG_L] = mem(hl());
-            break;
-
-        case 0x6f: // LD L,A
-            regs[REG_L] = regs[REG_A];
-            break;
-
-        case 0x70: // LD (HL),B
-            memw(hl(), regs[REG_B]);
-            break;
-
-        case 0x71: // LD (HL),C
-            memw(hl(), regs[REG_C]);
-            break;
-
-        case 0x72: // LD (HL),D
-            memw(hl(), regs[REG_D]);
-            break;
-
-        case 0x73: // LD (HL),E
-            memw(hl(), regs[REG_E]);
-            break;
-
-        case 0x74: // LD (HL),H
-            memw(hl(), regs[REG_H]);
-            break;
-
-        case 0x75: // LD (HL),L
-            memw(hl(), regs[REG_L]);
-            break;
-
-        case 0x76: // HALT
-            halted = true;
-            break;
-
-        case 0x77: // LD (HL),A
-            memw(hl(), regs[REG_A]);
-            break;
-
-        case 0x78: // LD A,B
-            regs[REG_A] = regs[REG_B];
-            break;
-
-        case 0x79: // LD A,C
-            regs[REG_A] = regs[REG_C];
-            break;
-
-        case 0x7a: // LD A,D
-            regs[REG_A] = regs[REG_D];
-            break;
-
-        case 0x7b: // LD A,E
-            regs[REG_A] = regs[REG_E];
-            break;
-
-        case 0x7c: // LD A,H
-            regs[REG_A] = regs[REG_H];
-            break;
-
-        case 0x7d: // LD A,L
-            regs[REG_A] = regs[REG_L];
-            break;
-
-        case 0x7e: // LD A,(HL)
-            regs[REG_A] = mem(hl());
-            break;
-
-        case 0x7f: // LD A,A
-            break;
-
-        case 0x80: // ADD A,B
-            instr_add(regs[REG_B]);
-            break;
-
-        case 0x81: // ADD A,C
-            instr_add(regs[REG_C]);
-            break;
-
-        case 0x82: // ADD A,D
-            instr_add(regs[REG_D]);
-            break;
-
-        case 0x83: // ADD A,E
-            instr_add(regs[REG_E]);
-            break;
-
-        case 0x84: // ADD A,H
-            instr_add(regs[REG_H]);
-            break;
-
-        case 0x85: // ADD A,L
-            instr_add(regs[REG_L]);
-            break;
-
-        case 0x86: // ADD A,(HL)
-            instr_add(mem(hl()));
-            break;
-
-        case 0x87: // ADD A,A
-            instr_add(regs[REG_A]);
-            break;
-
-        case 0x88: // ADC A,B
-            instr_adc(regs[REG_B]);
-            break;
-
-        case 0x89: // ADC A,C
-            instr_adc(regs[REG_C]);
-            break;
-
-        case 0x8a: // ADC A,D
-            instr_adc(regs[REG_D]);
-            break;
-
-        case 0x8b: // ADC A,E
-            instr_adc(regs[REG_E]);
-            break;
-
-        case 0x8c: // ADC A,H
-            instr_adc(regs[REG_H]);
-            break;
-
-        case 0x8d: // ADC A,L
-            instr_adc(regs[REG_L]);
-            break;
-
-        case 0x8e: // ADC A,(HL)
-            instr_adc(mem(hl()));
-            break;
-
-        case 0x8f: // ADC A,A
-            instr_adc(regs[REG_A]);
-            break;
-
-        case 0x90: // SUB B
-            instr_sub(regs[REG_B]);
-            break;
-
-        case 0x91: // SUB C
-            instr_sub(regs[REG_C]);
-            break;
-
-        case 0x92: // SUB D
-            instr_sub(regs[REG_D]);
-            break;
-
-        case 0x93: // SUB E
-            instr_sub(regs[REG_E]);
-            break;
-
-        case 0x94: // SUB H
-            instr_sub(regs[REG_H]);
-            break;
-
-        case 0x95: // SUB L
-            instr_sub(regs[REG_L]);
-            break;
-
-        case 0x96: // SUB (HL)
-            instr_sub(mem(hl()));
-            break;
-
-        case 0x97: // SUB A
-            instr_sub(regs[REG_A]);
-            break;
-
-        case 0x98: // SBC A,B
-            instr_sbc(regs[REG_B]);
-            break;
-
-        case 0x99: // SBC A,C
-            instr_sbc(regs[REG_C]);
-            break;
-
-        case 0x9a: // SBC A,D
-            instr_sbc(regs[REG_D]);
-            break;
-
-        case 0x9b: // SBC A,E
-            instr_sbc(regs[REG_E]);
-            break;
-
-        case 0x9c: // SBC A,H
-            instr_sbc(regs[REG_H]);
-            break;
-
-        case 0x9d: // SBC A,L
-            instr_sbc(regs[REG_L]);
-            break;
-
-        case 0x9e: // SBC A,(HL)
-            instr_sbc(mem(hl()));
-            break;
-
-        case 0x9f: // SBC A,A
-            instr_sbc(regs[REG_A]);
-            break;
-
-        case 0xa0: // AND B
-            instr_and(regs[REG_B]);
-            break;
-
-        case 0xa1: // AND C
-            instr_and(regs[REG_C]);
-            break;
-
-        case 0xa2: // AND D
-            instr_and(regs[REG_D]);
-            break;
-
-        case 0xa3: // AND E
-            instr_and(regs[REG_E]);
-            break;
-
-        case 0xa4: // AND H
-            instr_and(regs[REG_H]);
-            break;
-
-        case 0xa5: // AND L
-            instr_and(regs[REG_L]);
-            break;
-
-        case 0xa6: // AND (HL)
-            instr_and(mem(hl()));
-            break;
-
-        case 0xa7: // AND A
-            instr_and(regs[REG_A]);
-            break;
-
-        case 0xa8: // XOR B
-            instr_xor(regs[REG_B]);
-            break;
-
-        case 0xa9: // XOR C
-            instr_xor(regs[REG_C]);
-            break;
-
-        case 0xaa: // XOR D
-            instr_xor(regs[REG_D]);
-            break;
-
-        case 0xab: // XOR E
-            instr_xor(regs[REG_E]);
-            break;
-
-        case 0xac: // XOR H
-            instr_xor(regs[REG_H]);
-            break;
-
-        case 0xad: // XOR L
-            instr_xor(regs[REG_L]);
-            break;
-
-        case 0xae: // XOR (HL)
-            instr_xor(mem(hl()));
-            break;
-
-        case 0xaf: // XOR A
-            instr_xor(regs[REG_A]);
-            break;
-
-        case 0xb0: // OR B
-            instr_or(regs[REG_B]);
-            break;
-
-        case 0xb1: // OR C
-            instr_or(regs[REG_C]);
-            break;
-
-        case 0xb2: // OR D
-            instr_or(regs[REG_D]);
-            break;
-
-        case 0xb3: // OR E
-            instr_or(regs[REG_E]);
-            break;
-
-        case 0xb4: // OR H
-            instr_or(regs[REG_H]);
-            break;
-
-        case 0xb5: // OR L
-            instr_or(regs[REG_L]);
-            break;
-
-        case 0xb6: // OR (HL)
-            instr_or(mem(hl()));
-            break;
-
-        case 0xb7: // OR A
-            instr_or(regs[REG_A]);
-            break;
-
-        case 0xb8: // CP B
-            instr_cp(regs[REG_B]);
-            break;
-
-        case 0xb9: // CP C
-            instr_cp(regs[REG_C]);
-            break;
-
-        case 0xba: // CP D
-            instr_cp(regs[REG_D]);
-            break;
-
-        case 0xbb: // CP E
-            instr_cp(regs[REG_E]);
-            break;
-
-        case 0xbc: // CP H
-            instr_cp(regs[REG_H]);
-            break;
-
-        case 0xbd: // CP L
-            instr_cp(regs[REG_L]);
-            break;
-
-        case 0xbe: // CP (HL)
-            instr_cp(mem(hl()));
-            break;
-
-        case 0xbf: // CP A
-            instr_cp(regs[REG_A]);
-            break;
-
-        case 0xc0: // RET NZ
-            if (!z) {
-                pc = pop16();
-                eff.cycles = 20;
-            } else {
-                eff.cycles = 8;
-            }
-            break;
-
-        case 0xc1: // POP BC
-            regs[REG_C] = pop8();
-            regs[REG_B] = pop8();
-            break;
-
-        case 0xc2: // JP NZ,a16
-            if (!z) {
-                pc = mem(pc) | (mem(pc+1) << 8);
-                eff.cycles = 16;
-            } else {
-                pc += 2;
-                eff.cycles = 12;
-            }
-            break;
-
-        case 0xc3: // JP a16
-            pc = mem(pc) | (mem(pc+1) << 8);
-            eff.cycles = 16;
-            break;
-
-        case 0xc4: // CALL NZ,a16
-            if (!z) {
-                push(pc+2);
-                pc = mem(pc) | (mem(pc+1) << 8);
-                eff.cycles = 24;
-            } else {
-                pc += 2;
-                eff.cycles = 12;
-            }
-            break;
-
-        case 0xc5: // PUSH BC
-            push(bc());
-            break;
-
-        case 0xc6: // ADD A,d8
-        {
-            instr_add(mem(pc++));
-            break;
-        }
-
-        case 0xc7: // RST 00H
-            instr_rst(0);
-            break;
-
-        case 0xc8: // RET Z
-            if (z) {
-                pc = pop16();
-                eff.cycles = 20;
-            } else {
-                eff.cycles = 8;
-            }
-            break;
-
-        case 0xc9: // RET
-            pc = pop16();
-            break;
-
-        case 0xca: // JP Z,a16
-            if (z) {
-                pc = mem(pc) | (mem(pc+1) << 8);
-                eff.cycles = 16;
-            } else {
-                pc += 2;
-                eff.cycles = 12;
-            }
-            break;
-
-        case 0xcb: // PREFIX
-            execPrefix(eff);
-            break;
-
-        case 0xcc: // CALL Z,a16
-            if (z) {
-                push(pc+2);
-                pc = mem(pc) | (mem(pc+1) << 8);
-                eff.cycles = 24;
-            } else {
-                pc += 2;
-                eff.cycles = 12;
-            }
-            break;
-
-        case 0xcd: // CALL a16
-            push(pc+2);
-            pc = mem(pc) | (mem(pc+1) << 8);
-            break;
-
-        case 0xce: // ADC A,d8
-        {
-            instr_adc(mem(pc++));
-            break;
-        }
-
-        case 0xcf: // RST 08H
-            instr_rst(0x08);
-            break;
-
-        case 0xd0: // RET NC
-            if (!c) {
-                pc = pop16();
-                eff.cycles = 20;
-            } else {
-                eff.cycles = 8;
-            }
-            break;
-
-        case 0xd1: // POP DE
-            regs[REG_E] = pop8();
-            regs[REG_D] = pop8();
-            break;
-
-        case 0xd2: // JP NC,a16
-            if (!c) {
-                pc = mem(pc) | (mem(pc+1) << 8);
-                eff.cycles = 16;
-            } else {
-                pc += 2;
-                eff.cycles = 12;
-            }
-            break;
-
-        case 0xd4: // CALL NC,a16
-            if (!c) {
-                push(pc+2);
-                pc = mem(pc) | (mem(pc+1) << 8);
-                eff.cycles = 24;
-            } else {
-                pc += 2;
-                eff.cycles = 12;
-            }
-            break;
-
-        case 0xd5: // PUSH DE
-            push(de());
-            break;
-
-        case 0xd6: // SUB d8
-            instr_sub(mem(pc++));
-            break;
-
-        case 0xd7: // RST 10H
-            instr_rst(0x10);
-            break;
-
-        case 0xd8: // RET C
-            if (c) {
-                pc = pop16();
-                eff.cycles = 20;
-                break;
-            } else {
-                eff.cycles = 8;
-            }
-            break;
-
-        case 0xd9: // RETI
-            ime = true;
-            pc = pop16();
-            break;
-
-        case 0xda: // JP C,a16
-            if (c) {
-                pc = mem(pc) | (mem(pc+1) << 8);
-                eff.cycles = 16;
-            } else {
-                pc += 2;
-                eff.cycles = 12;
-            }
-            break;
-
-        case 0xdc: // CALL C,a16
-            if (c) {
-                push(pc+2);
-                pc = mem(pc) | (mem(pc+1) << 8);
-                eff.cycles = 24;
-            } else {
-                pc += 2;
-                eff.cycles = 12;
-            }
-            break;
-
-        case 0xde: // SBC A,d8
-            instr_sbc(mem(pc++));
-            break;
-
-        case 0xdf: // RST 18H
-            instr_rst(0x18);
-            break;
-
-        case 0xe0: // LD ($ff00+a8),A
-            memw(0xff00 + mem(pc++), regs[REG_A]);
-            break;
-
-        case 0xe1: // POP HL
-            regs[REG_L] = pop8();
-            regs[REG_H] = pop8();
-            break;
-
-        case 0xe2: // LD ($ff00+C),A
-            memw(0xff00+regs[REG_C], regs[REG_A]);
-            break;
-
-        case 0xe5: // PUSH HL
-            push(hl());
-            break;
-
-        case 0xe6: // AND d8
-            instr_and(mem(pc++));
-            break;
-
-        case 0xe7: // RST 20H
-            instr_rst(0x20);
-            break;
-
-        case 0xea: // LD (a16),A
-            memw(mem(pc) | (mem(pc+1) << 8), regs[REG_A]);
-            pc += 2;
-            break;
-
-        case 0xe8: // ADD SP,r8
-        {
-            uint16_t u8 = mem(pc++);
-            int16_t r8 = unsigned_to_signed(u8);
-            c = (sp & 0xff) + (u8 & 0xff) > 0xff;
-            h = (sp & 0xf) + (u8 & 0xf) > 0xf;
-            z = n = 0;
-            sp += r8;
-            break;
-        }
-
-        case 0xe9: // JP HL
-            pc = hl();
-            break;
-
-        case 0xee: // XOR d8
-            instr_xor(mem(pc++));
-            break;
-
-        case 0xef: // RST $28
-            instr_rst(0x28);
-            break;
-
-
-        case 0xf0: // LD A,($ff00+a8)
-            regs[REG_A] = mem(0xff00+mem(pc++));
-            break;
-
-        case 0xf1: // POP AF
-        {
-            uint8_t f = pop8();
-            regs[REG_A] = pop8();
-            z = f >> 7;
-            n = (f >> 6) & 1;
-            h = (f >> 5) & 1;
-            c = (f >> 4) & 1;
-            break;
-        }
-
-        case 0xf2: // LDH A,(C)
-            regs[REG_A] = mem(0xff00+regs[REG_C]);
-            break;
-
-        case 0xf3: // DI
-            ime = false;
-            break;
-
-        case 0xf5: // PUSH AF
-            push(af());
-            break;
-
-        case 0xf6: // OR d8
-            instr_or(mem(pc++));
-            break;
-
-        case 0xf7: // RST 30H
-            instr_rst(0x30);
-            break;
-
-        case 0xf8: // LD HL,SP+r8
-        {
-            uint16_t u8 = mem(pc++);
-            int16_t r8 = unsigned_to_signed(u8);
-            c = (sp & 0xff) + (u8 & 0xff) > 0xff;
-            h = (sp & 0xf) + (u8 & 0xf) > 0xf;
-            z = n = 0;
-            uint16_t v = sp+r8;
-            regs[REG_L] = v & 0xff;
-            regs[REG_H] = v >> 8;
-            break;
-        }
-
-        case 0xf9: // LD SP,HL
-            sp = hl();
-            break;
-
-
-        case 0xfb: // EI
-            ime = true;
-            break;
-            // FIXME: bug here: the next instruction cannot be interrupted on the GB
-
-        case 0xfa: // LD A,(a16)
-            regs[REG_A] = mem(mem(pc) | (mem(pc+1) << 8));
-            pc += 2;
-            break;
-
-        case 0xfe: // CP d8
-        {
-            instr_cp(mem(pc++));
-            break;
-        }
-
-        case 0xff: // RST 38H
-            instr_rst(0x38);
-            break;
-
-        default:
-            fprintf(stderr, "Unknown instruction %02x at address %04x\n", instr, pc-1);
-            exit(1);
-    }
-
-}
-
-SideEffects Cpu::cycle()
-{
-    SideEffects eff{};
-    eff.cycles = 0;
-    eff.break_ = false;
-
-    if ((ie & if_) != 0) {
-        halted = false;
-    }
-
-    if (ime) {
-        uint16_t int_handlers[] = {0x40, 0x48, 0x50, 0x58, 0x60};
-        for (int i = 0; i <= 4; i++)
-        {
-            if (((ie & if_) >> i) & 1) {
-                if_ &= ~(1 << i);
-                ime = false;
-                push(pc);
-                pc = int_handlers[i];
-
-                eff.cycles = 5*4;
-            }
-        }
-    }
-
-    if (eff.cycles == 0) {
-        if (halted) {
-            eff.cycles += 4;
-        } else {
-            //fprintf(log_file, "A: %02x B: %02x C: %02x D: %02x E: %02x H: %02x L: %02x F: %02x PC: %04x (%02x %02x %02x) LY: %02x\n", regs[REG_A], regs[REG_B], regs[REG_C], regs[REG_D], regs[REG_E], regs[REG_H], regs[REG_L], af() & 0xff, pc, mem(pc), mem(pc+1), mem(pc+2), ppu->ly);
-            uint8_t instr = mem(pc);
-            pc++;
-            executeInstruction(instr, eff);
-        }
-    }
-
-    assert(eff.cycles > 0);
-
-    timer->update(eff.cycles, *this);
-
-    // serial.exec(eff.cycles);
-
-    if (pc == breakpoint) eff.break_ = true;
-    return eff;
-}
-
-void Cpu::execPrefix(SideEffects& eff)
-{
-    uint8_t instr = mem(pc++);
-    // TODO: algorithmic decoding
-
-    Opcode opcode = g_prefix_opcode_table[instr];
-    eff.cycles = opcode.cycles;
-    
-
-    if (instr >= 0x40 && instr <= 0x7f) { // BIT
-        uint16_t off = instr - 0x40;
-        uint8_t bit = off / 0x8;
-        uint8_t reg = off % 0x8;
-        uint8_t v;
-        
-        switch(reg) {
-            case 0:
-                v = regs[REG_B];
-                break;
-
-            case 1:
-                v = regs[REG_C];
-                break;
-
-            case 2:
-                v = regs[REG_D];
-                break;
-
-            case 3:
-                v = regs[REG_E];
-                break;
-
-            case 4:
-                v = regs[REG_H];
-                break;
-
-            case 5:
-                v = regs[REG_L];
-                break;
-
-            case 6:
-                v = mem(hl());
-                break;
-
-            case 7:
-                v = regs[REG_A];
-                break;
-        }
-        z = (v & (1 << bit)) == 0;
-        n = 0;
-        h = 1;
-        return;
-    }
-
-    if (instr >= 0x80 && instr <= 0xbf) { // res
-        uint16_t off = instr - 0x80;
-        uint8_t bit = off / 0x8;
-        uint8_t reg = off % 0x8;
-        if (reg == 6) { // (HL)
-            memw(hl(), mem(hl()) & ~(1 << bit));
-        } else {
-            uint8_t* v;
-            switch(reg) {
-                case 0:
-                    v = &regs[REG_B];
-                    break;
-
-                case 1:
-                    v = &regs[REG_C];
-                    break;
-
-                case 2:
-                    v = &regs[REG_D];
-                    break;
-
-                case 3:
-                    v = &regs[REG_E];
-                    break;
-
-                case 4:
-                    v = &regs[REG_H];
-                    break;
-
-                case 5:
-                    v = &regs[REG_L];
-                    break;
-
-                case 7:
-                    v = &regs[REG_A];
-                    break;
-            }
-            *v &= ~(1 << bit);
-        }
-        return;
-    }
-
-    if (instr >= 0xc0) { // SET
-        uint16_t off = instr - 0xc0;
-        uint8_t bit = off / 0x8;
-        uint8_t reg = off % 0x8;
-        if (reg == 6) { // (HL)
-            memw(hl(), mem(hl()) | (1 << bit));
-        } else {
-            uint8_t* v;
-            switch(reg) {
-                case 0:
-                    v = &regs[REG_B];
-                    break;
-
-                case 1:
-                    v = &regs[REG_C];
-                    break;
-
-                case 2:
-                    v = &regs[REG_D];
-                    break;
-
-                case 3:
-                    v = &regs[REG_E];
-                    break;
-
-                case 4:
-                    v = &regs[REG_H];
-                    break;
-
-                case 5:
-                    v = &regs[REG_L];
-                    break;
-
-                case 7:
-                    v = &regs[REG_A];
-                    break;
-            }
-            *v |= 1 << bit;
-        }
-        return;
-    }
-
-    switch(instr) {
-
-        case 0x00: // RLC B
-            instr_rlc(regs[REG_B]);
-            break;
-
-        case 0x01: // RLC C
-            instr_rlc(regs[REG_C]);
-            break;
-
-        case 0x02: // RLC D
-            instr_rlc(regs[REG_D]);
-            break;
-
-        case 0x03: // RLC E
-            instr_rlc(regs[REG_E]);
-            break;
-
-        case 0x04: // RLC H
-            instr_rlc(regs[REG_H]);
-            break;
-
-        case 0x05: // RLC L
-            instr_rlc(regs[REG_L]);
-            break;
-
-        case 0x06: // RLC (HL)
-        {
-            uint8_t v = mem(hl());
-            c = v >> 7;
-            v <<= 1;
-            v |= c;
-            z = v == 0;
-            n = h = 0;
-            memw(hl(), v);
-            break;
-        }
-
-        case 0x07: // RLC A
-            instr_rlc(regs[REG_A]);
-            break;
-
-        case 0x08: // RRC B
-            instr_rrc(regs[REG_B]);
-            break;
-
-        case 0x09: // RRC C
-            instr_rrc(regs[REG_C]);
-            break;
-
-        case 0x0a: // RRC D
-            instr_rrc(regs[REG_D]);
-            break;
-
-        case 0x0b: // RRC E
-            instr_rrc(regs[REG_E]);
-            break;
-
-        case 0x0c: // RRC H
-            instr_rrc(regs[REG_H]);
-            break;
-
-        case 0x0d: // RRC L
-            instr_rrc(regs[REG_L]);
-            break;
-
-        case 0x0e: // RRC (HL)
-        {
-            uint8_t v = mem(hl());
-            instr_rrc(v);
-            memw(hl(), v);
-            break;
-        }
-
-        case 0x0f: // RRC A
-            instr_rrc(regs[REG_A]);
-            break;
-
-        case 0x10: // RL B
-            instr_rl(regs[REG_B]);
-            break;
-
-        case 0x11: // RL C
-            instr_rl(regs[REG_C]);
-            break;
-
-        case 0x12: // RL D
-            instr_rl(regs[REG_D]);
-            break;
-
-        case 0x13: // RL E
-            instr_rl(regs[REG_E]);
-            break;
-
-        case 0x14: // RL H
-            instr_rl(regs[REG_H]);
-            break;
-
-        case 0x15: // RL L
-            instr_rl(regs[REG_L]);
-            break;
-
-        case 0x16: // RL (HL)
-        {
-            uint8_t v = mem(hl());
-            instr_rl(v);
-            memw(hl(), v);
-            break;
-        }
-
-        case 0x17: // RL A
-            instr_rl(regs[REG_A]);
-            break;
-
-        case 0x18: // RR B
-            instr_rr(regs[REG_B]);
-            break;
-
-        case 0x19: // RR C
-            instr_rr(regs[REG_C]);
-            break;
-
-        case 0x1a: // RR D
-            instr_rr(regs[REG_D]);
-            break;
-
-        case 0x1b: // RR E
-            instr_rr(regs[REG_E]);
-            break;
-
-        case 0x1c: // RR H
-            instr_rr(regs[REG_H]);
-            break;
-
-        case 0x1d: // RR L
-            instr_rr(regs[REG_L]);
-            break;
-
-        case 0x1e: // RR (HL)
-        {
-            uint8_t v = mem(hl());
-            instr_rr(v);
-            memw(hl(), v);
-            break;
-        }
-
-        case 0x1f: // RR A
-            instr_rr(regs[REG_A]);
-            break;
-
-        case 0x20: // SLA B
-            instr_sla(regs[REG_B]);
-            break;
-
-        case 0x21: // SLA C
-            instr_sla(regs[REG_C]);
-            break;
-
-        case 0x22: // SLA D
-            instr_sla(regs[REG_D]);
-            break;
-
-        case 0x23: // SLA E
-            instr_sla(regs[REG_E]);
-            break;
-
-        case 0x24: // SLA H
-            instr_sla(regs[REG_H]);
-            break;
-
-        case 0x25: // SLA L
-            instr_sla(regs[REG_L]);
-            break;
-
-        case 0x26: // SLA (HL)
-        {
-            uint8_t v = mem(hl());
-            instr_sla(v);
-            memw(hl(), v);
-            break;
-        }
-
-        case 0x27: // SLA A
-            instr_sla(regs[REG_A]);
-            break;
-
-        case 0x28: // SRA B
-            instr_sra(regs[REG_B]);
-            break;
-
-        case 0x29: // SRA C
-            instr_sra(regs[REG_C]);
-            break;
-
-        case 0x2a: // SRA D
-            instr_sra(regs[REG_D]);
-            break;
-
-        case 0x2b: // SRA E
-            instr_sra(regs[REG_E]);
-            break;
-
-        case 0x2c: // SRA H
-            instr_sra(regs[REG_H]);
-            break;
-
-        case 0x2d: // SRA L
-            instr_sra(regs[REG_L]);
-            break;
-
-        case 0x2e: // SRA (HL)
-        {
-            uint8_t v = mem(hl());
-            instr_sra(v);
-            memw(hl(), v);
-            break;
-        }
-
-        case 0x2f: // SRA A
-            instr_sra(regs[REG_A]);
-            break;
-
-        case 0x30: // SWAP B
-            instr_swap(regs[REG_B]);
-            break;
-
-        case 0x31: // SWAP C
-            instr_swap(regs[REG_C]);
-            break;
-
-        case 0x32: // SWAP D
-            instr_swap(regs[REG_D]);
-            break;
-
-        case 0x33: // SWAP E
-            instr_swap(regs[REG_E]);
-            break;
-
-        case 0x34: // SWAP H
-            instr_swap(regs[REG_H]);
-            break;
-
-        case 0x35: // SWAP L
-            instr_swap(regs[REG_L]);
-            break;
-
-        case 0x36: // SWAP (HL)
-        {
-            uint8_t v = mem(hl());
-            instr_swap(v);
-            memw(hl(), v);
-            break;
-        }
-
-        case 0x37: // SWAP A
-            regs[REG_A] = ((regs[REG_A] & 0x0f) << 4) | ((regs[REG_A] & 0xf0) >> 4);
-            z = regs[REG_A] == 0;
-            n = h = c = 0;
-            break;
-
-        case 0x38: // SRL B
-            instr_srl(regs[REG_B]);
-            break;
-
-        case 0x39: // SRL C
-            instr_srl(regs[REG_C]);
-            break;
-
-        case 0x3a: // SRL D
-            instr_srl(regs[REG_D]);
-            break;
-
-        case 0x3b: // SRL E
-            instr_srl(regs[REG_E]);
-            break;
-
-        case 0x3c: // SRL H
-            instr_srl(regs[REG_H]);
-            break;
-
-        case 0x3d: // SRL L
-            instr_srl(regs[REG_L]);
-            break;
-
-        case 0x3e: // SRL (HL)
-        {
-            uint8_t v = mem(hl());
-            instr_srl(v);
-            memw(hl(), v);
-            break;
-        }
-
-        case 0x3f: // SRL A
-            instr_srl(regs[REG_A]);
-            break;
-
-        default:
-            fprintf(stderr, "Unknown prefix instruction CB %02x (pc = %02x)\n", instr, pc-2);
-            exit(1);
-    }
-}
-
-
-// Stolen from SameBoy
-void Cpu::daa()
-{
-
-    int16_t result = regs[REG_A];
-
-    if (n) {
-        if (h) {
-            result = (result - 0x06) & 0xFF;
-        }
-
-        if (c) {
-            result -= 0x60;
-        }
-    }
-    else {
-        if (h || (result & 0x0F) > 0x09) {
-            result += 0x06;
-        }
-
-        if (c || result > 0x9F) {
-            result += 0x60;
-        }
-    }
-
-    if ((result & 0x100) == 0x100) {
-        c = 1;
-    }
-    h = 0;
-    regs[REG_A] = result & 0xff;
-    z = regs[REG_A] == 0;
-}
-
-SerialController::SerialController(Cpu* cpu)
-{
-    this->cpu = cpu;
-    remaining = 0;
-    remaining_bits = 0;
-    sb = 0;
-    sc = 0x7e;
-}
-
-void SerialController::exec(uint8_t cycles)
-{
-    // TODO: external clock, clock speeds
-    if ((sc & (1 << 7)) > 0) {
-        if (remaining_bits == 0) { // begin transfer
-            remaining_bits = 8;
-        }
-        remaining -= cycles;
-        if (remaining <= 0) { // send a bit
-            remaining = 512;
-            remaining_bits--;
-
-            sb <<= 1; // receive a 0
-
-            if (remaining_bits == 0) { // end transfer
-                sc &= ~(1 << 7);
-                cpu->if_ |= (1 << 3);
-            }
-        }
-    }
-}
-
-
-JoypadController::JoypadController()
+uint8_t JoypadController::joyp() const
 {
-    select_buttons = true;
-    buttons_state = 0b11011111;
-    directions_state = 0b11101111;
+    return select_buttons ? buttons_state : directions_state;
 }
 
-uint8_t JoypadController::joyp() const
+void JoypadController::map_io(Cpu& cpu)
 {
-    return select_buttons ? buttons_state : directions_state;
+    cpu.map_io(0xFF00, this, nullptr,
+        [](void* ctx) { return ((JoypadController*)ctx)->joyp(); },
+        [](void* ctx, uint8_t v) { ((JoypadController*)ctx)->select_buttons = (v & (1 << 5)) == 0; });
 }
 
 void Cpu::instr_bit(uint8_t v, uint8_t bit)
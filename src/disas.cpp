@@ -5,10 +5,15 @@
 #include "opcodes.hpp"
 #include "util.hpp"
 
-void disassemble(const Cpu& cpu, uint16_t& pc, char* buf, unsigned int buf_size)
+void disassemble(Cpu& cpu, uint16_t& pc, char* buf, unsigned int buf_size)
 {
     uint8_t instr = cpu.mem(pc);
     Opcode op = g_opcode_table[instr];
+    if (instr == 0xCB) {
+        snprintf(buf, buf_size, "%s", g_prefix_opcode_table[cpu.mem(pc+1)].format_str);
+        pc += 2;
+        return;
+    }
     uint8_t operand_size = get_operand_num_bytes(op.operand);
 
     switch (op.operand) {
@@ -0,0 +1,135 @@
+#include "fusion.hpp"
+#include "opcodes.hpp"
+#include <algorithm>
+#include <string.h>
+#include <vector>
+
+const FusionInfo g_fusion_info[FUSE_COUNT] = {
+    { "none", 1 },
+    { "LD A,(HL+) / LD (DE),A", 2 },
+    { "DEC r / JR NZ", 2 },
+    { "LDH A,(n) / CP n / JR cc", 3 },
+    { "LDH A,(n) / AND n / JR cc", 3 },
+    { "LD A,B / OR C / JR NZ", 3 },
+};
+
+static bool is_dec_r(uint8_t opcode)
+{
+    return (opcode & 0xc7) == 0x05 && opcode != 0x35;
+}
+
+uint8_t match_fusion(const DecodedInstr* instrs, size_t count)
+{
+    if (count < 2) return FUSE_NONE;
+    uint8_t a = instrs[0].opcode;
+    uint8_t b = instrs[1].opcode;
+
+    if (a == 0x2a && b == 0x12) return FUSE_COPY;
+    if (is_dec_r(a) && b == 0x20) return FUSE_DEC_JRNZ;
+
+    if (count < 3) return FUSE_NONE;
+    uint8_t c = instrs[2].opcode;
+    bool jr_z_nz = c == 0x20 || c == 0x28;
+
+    if (a == 0xf0 && b == 0xfe && jr_z_nz) return FUSE_POLL_CP;
+    if (a == 0xf0 && b == 0xe6 && jr_z_nz) return FUSE_POLL_AND;
+    if (a == 0x78 && b == 0xb1 && c == 0x20) return FUSE_TEST_BC;
+    return FUSE_NONE;
+}
+
+bool idle_pollable(uint8_t port)
+{
+    return port == 0x0f || port == 0x41 || port == 0x44 || (port >= 0x80 && port != 0xff);
+}
+
+void IdleLoopLog::record(uint16_t address, uint16_t bank, uint8_t fusion, uint8_t port, unsigned int cycles)
+{
+    IdleLoop& loop = loops[((uint32_t)bank << 16) | address];
+    if (loop.skips == 0) {
+        loop.address = address;
+        loop.bank = bank;
+        loop.fusion = fusion;
+        loop.port = port;
+    }
+    loop.skips++;
+    loop.skipped_cycles += cycles;
+}
+
+void IdleLoopLog::report(FILE* f, const char* title) const
+{
+    std::vector<const IdleLoop*> sorted;
+    for (const auto& l : loops) sorted.push_back(&l.second);
+    std::sort(sorted.begin(), sorted.end(), [](const IdleLoop* a, const IdleLoop* b) {
+        return a->skipped_cycles > b->skipped_cycles;
+    });
+
+    fprintf(f, "Idle loops in %s: %zu\n", title, sorted.size());
+    for (const IdleLoop* l : sorted) {
+        fprintf(f, "%02x:%04x  %-28s FF%02x  skipped %10llu times, %12llu cycles\n", l->bank, l->address,
+            g_fusion_info[l->fusion].name, l->port, (unsigned long long)l->skips, (unsigned long long)l->skipped_cycles);
+    }
+}
+
+#ifdef GBEMU_FUSION_PROFILE
+FusionProfile::FusionProfile(): pairs(0x10000)
+{
+    history = 0;
+    executed = 0;
+    memset(fired, 0, sizeof(fired));
+    memset(instrs, 0, sizeof(instrs));
+    memset(sampled_ns, 0, sizeof(sampled_ns));
+    memset(sampled_instrs, 0, sizeof(sampled_instrs));
+    run_ns = 0;
+}
+
+static void print_sequence(FILE* f, uint32_t seq, int length)
+{
+    for (int i = length - 1; i >= 0; i--) {
+        uint8_t op = (seq >> (8 * i)) & 0xff;
+        fprintf(f, "%s%s", g_opcode_table[op].format_str, i ? " / " : "\n");
+    }
+}
+
+void FusionProfile::report(FILE* f) const
+{
+    const size_t top = 16;
+
+    std::vector<std::pair<uint64_t, uint32_t>> sorted;
+    for (uint32_t i = 0; i < pairs.size(); i++) {
+        if (pairs[i]) sorted.push_back({ pairs[i], i });
+    }
+    std::sort(sorted.rbegin(), sorted.rend());
+    fprintf(f, "Most frequent opcode pairs (%llu instructions):\n", (unsigned long long)executed);
+    for (size_t i = 0; i < sorted.size() && i < top; i++) {
+        fprintf(f, "%12llu  %04x  ", (unsigned long long)sorted[i].first, sorted[i].second);
+        print_sequence(f, sorted[i].second, 2);
+    }
+
+    sorted.clear();
+    for (const auto& t : triples) sorted.push_back({ t.second, t.first });
+    std::sort(sorted.rbegin(), sorted.rend());
+    fprintf(f, "Most frequent opcode triples:\n");
+    for (size_t i = 0; i < sorted.size() && i < top; i++) {
+        fprintf(f, "%12llu  %06x  ", (unsigned long long)sorted[i].first, sorted[i].second);
+        print_sequence(f, sorted[i].second, 3);
+    }
+
+    // Time saved is estimated from the sampled cost of an instruction run
+    // through a fused handler against the average cost of the others.
+    uint64_t fused_instrs = 0;
+    double fused_ns = 0;
+    for (int i = 1; i < FUSE_COUNT; i++) {
+        fused_instrs += instrs[i];
+        if (sampled_instrs[i]) fused_ns += (double)sampled_ns[i] / sampled_instrs[i] * instrs[i];
+    }
+    double other_ns = executed > fused_instrs ? (run_ns - fused_ns) / (executed - fused_instrs) : 0;
+
+    fprintf(f, "Fusions (%.1f ns per unfused instruction):\n", other_ns);
+    for (int i = 1; i < FUSE_COUNT; i++) {
+        double ns = sampled_instrs[i] ? (double)sampled_ns[i] / sampled_instrs[i] : 0;
+        double saved = sampled_instrs[i] ? (other_ns - ns) * instrs[i] / 1e6 : 0;
+        fprintf(f, "%-28s fired %10llu  instructions %12llu  %.1f ns each  saved ~%.2f ms\n", g_fusion_info[i].name,
+            (unsigned long long)fired[i], (unsigned long long)instrs[i], ns, saved);
+    }
+}
+#endif
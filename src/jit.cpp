@@ -0,0 +1,272 @@
+#include "jit.hpp"
+#include "cpu.hpp"
+#include "opcodes.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define JIT_X86_64
+#include <sys/mman.h>
+#endif
+
+// Set by exec_instr above the cycles it returns
+constexpr unsigned int EXIT_BLOCK = 0x100;
+
+// Worst case cost, the taken path for conditional branches
+static unsigned int max_cycles(const DecodedInstr& instr)
+{
+    if (instr.opcode == 0xcb) return instr.cycles;
+    return g_opcode_info[instr.opcode].cycles_taken;
+}
+
+Jit::Jit()
+{
+    code = nullptr;
+    code_used = 0;
+    block_end = 0;
+#ifdef JIT_X86_64
+    supported = true;
+#else
+    supported = false;
+#endif
+}
+
+Jit::~Jit()
+{
+#ifdef JIT_X86_64
+    if (code) munmap(code, JIT_CODE_SIZE);
+#endif
+}
+
+uint8_t Jit::exec(Cpu& cpu)
+{
+    if (!supported) return 0;
+
+    Block* block = cpu.block_cache.enter(cpu);
+    if (!block) return 0;
+
+    if (!block->native) {
+        if (++block->entry_count < JIT_HOT_THRESHOLD) return 0;
+        if (!reserve()) {
+            // code buffer full: start over
+            code_used = 0;
+            cpu.block_cache.clear();
+            return 0;
+        }
+        block->native = compile(cpu, *block);
+        if (!block->native) return 0;
+    }
+    // the peripherals are only synced at exit
+    if (block->native_cycles > cpu.cycles_until_event()) return 0;
+
+    block_end = cpu.clock + block->native_cycles;
+    cpu.block_cache.code_changed = false;
+    cpu.block_cache.reset_cursor();
+    // compiled code reads and writes F directly
+    cpu.sync_flags();
+    return block->native(&cpu);
+}
+
+bool Jit::reserve()
+{
+#ifdef JIT_X86_64
+    if (!code) {
+        void* p = mmap(nullptr, JIT_CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            perror("JIT mmap");
+            supported = false;
+            return false;
+        }
+        code = (uint8_t*)p;
+    }
+    return code_used + JIT_MAX_BLOCK_CODE <= JIT_CODE_SIZE;
+#else
+    return false;
+#endif
+}
+
+// When the next peripheral event is due, the peripherals being synced to
+// different clocks
+uint64_t Jit::next_event(const Cpu& cpu)
+{
+    uint64_t next = UINT64_MAX;
+    for (unsigned int i = 0; i < EVENT_SOURCE_COUNT; i++) {
+        next = std::min(next, cpu.scheduler.synced[i] + cpu.until_event((EventSource)i));
+    }
+    return next;
+}
+
+// elapsed is what the block has run so far, the clock is only advanced
+// at exit. The instruction sees the clock it executes at, and the block
+// exits after it when it moved a peripheral event into the rest of the
+// block.
+unsigned int Jit::exec_instr(Cpu* cpu, uint64_t packed, unsigned int elapsed)
+{
+    DecodedInstr instr;
+    instr.opcode = packed & 0xff;
+    instr.length = (packed >> 8) & 0xff;
+    instr.cycles = (packed >> 16) & 0xff;
+    instr.operand = (packed >> 24) & 0xffff;
+
+    SideEffects eff{};
+    const Scheduler& sched = cpu->scheduler;
+    uint64_t synced[EVENT_SOURCE_COUNT];
+    if (!cpu->lazy_sync) memcpy(synced, sched.synced, sizeof(synced));
+    cpu->clock += elapsed;
+    cpu->pc += instr.length;
+    cpu->executeInstruction(instr, eff);
+    cpu->sync_flags();
+
+    uint64_t next = sched.next;
+    if (!cpu->lazy_sync) {
+        // Only the events at block entry are known. An I/O access catches
+        // its peripheral up, unless it comes first and they are all current.
+        next = cpu->jit.block_end;
+        if (elapsed == 0 || memcmp(synced, sched.synced, sizeof(synced)) != 0) next = next_event(*cpu);
+    }
+    cpu->clock -= elapsed;
+    return eff.cycles | (next < cpu->jit.block_end ? EXIT_BLOCK : 0);
+}
+
+void Jit::emit8(uint8_t v)
+{
+    code[code_used++] = v;
+}
+
+void Jit::emit16(uint16_t v)
+{
+    memcpy(code + code_used, &v, 2);
+    code_used += 2;
+}
+
+void Jit::emit32(uint32_t v)
+{
+    memcpy(code + code_used, &v, 4);
+    code_used += 4;
+}
+
+void Jit::emit64(uint64_t v)
+{
+    memcpy(code + code_used, &v, 8);
+    code_used += 8;
+}
+
+// rbx holds the Cpu pointer, r12d accumulates the cycles of the block and
+// is passed to exec_instr.
+// Register and flag accesses are [rbx+disp32].
+NativeBlock Jit::compile(const Cpu& cpu, Block& block)
+{
+#ifdef JIT_X86_64
+    auto offset = [&cpu](const void* field) {
+        return (uint32_t)((const uint8_t*)field - (const uint8_t*)&cpu);
+    };
+    const uint32_t pc_off = offset(&cpu.pc);
+    const uint32_t f_off = offset(&cpu.regs[REG_F]);
+    // ROM bank 0 can neither be switched nor written to
+    const bool check_code = block.start >= 0x4000;
+
+    uint8_t* entry = code + code_used;
+    std::vector<size_t> exit_jumps;
+
+    emit8(0x53);                                        // push rbx
+    emit8(0x41); emit8(0x54);                           // push r12
+    emit8(0x48); emit8(0x83); emit8(0xec); emit8(0x08); // sub rsp, 8
+    emit8(0x48); emit8(0x89); emit8(0xfb);              // mov rbx, rdi
+    emit8(0x45); emit8(0x31); emit8(0xe4);              // xor r12d, r12d
+
+    uint16_t pending_pc = 0;
+    uint32_t pending_cycles = 0;
+    auto flush_pending = [&]() {
+        if (pending_pc) {
+            emit8(0x66); emit8(0x81); emit8(0x83); emit32(pc_off); emit16(pending_pc); // add word [rbx+pc], imm16
+            pending_pc = 0;
+        }
+        if (pending_cycles) {
+            emit8(0x41); emit8(0x81); emit8(0xc4); emit32(pending_cycles); // add r12d, imm32
+            pending_cycles = 0;
+        }
+    };
+    auto and_f = [&](uint8_t v) {
+        emit8(0x80); emit8(0xa3); emit32(f_off); emit8(v); // and byte [rbx+F], imm8
+    };
+    auto or_f = [&](uint8_t v) {
+        emit8(0x80); emit8(0x8b); emit32(f_off); emit8(v); // or byte [rbx+F], imm8
+    };
+
+    unsigned int cycles = 0;
+    for (size_t i = 0; i < block.instrs.size(); i++) {
+        const DecodedInstr& instr = block.instrs[i];
+        if (i > 0 && cycles + max_cycles(instr) > JIT_MAX_BLOCK_CYCLES) break;
+        cycles += max_cycles(instr);
+
+        uint8_t op = instr.opcode;
+        uint8_t dst = operand_regs[(op >> 3) & 7];
+        uint8_t src = operand_regs[op & 7];
+
+        if (op == 0x00) { // NOP
+        } else if (op >= 0x40 && op <= 0x7f && dst != 0xff && src != 0xff) { // LD r,r'
+            emit8(0x8a); emit8(0x83); emit32(offset(&cpu.regs[src])); // mov al, [rbx+src]
+            emit8(0x88); emit8(0x83); emit32(offset(&cpu.regs[dst])); // mov [rbx+dst], al
+        } else if (op < 0x40 && (op & 7) == 6 && dst != 0xff) { // LD r,d8
+            emit8(0xc6); emit8(0x83); emit32(offset(&cpu.regs[dst])); emit8(instr.operand & 0xff);
+        } else if (op >= 0xa0 && op <= 0xb7 && src != 0xff) { // AND/XOR/OR r
+            static const uint8_t alu_ops[] = { 0x22, 0x32, 0x0a }; // and, xor, or al, r/m8
+            emit8(0x8a); emit8(0x83); emit32(offset(&cpu.regs[REG_A]));     // mov al, [rbx+A]
+            emit8(alu_ops[(op - 0xa0) >> 3]); emit8(0x83); emit32(offset(&cpu.regs[src]));
+            emit8(0x88); emit8(0x83); emit32(offset(&cpu.regs[REG_A]));     // mov [rbx+A], al
+            emit8(0x0f); emit8(0x94); emit8(0xc0);                          // sete al
+            emit8(0xc0); emit8(0xe0); emit8(0x07);                          // shl al, 7
+            if (op < 0xa8) { emit8(0x0c); emit8(0x20); }                    // or al, 0x20 (H)
+            emit8(0x88); emit8(0x83); emit32(f_off);                        // mov [rbx+F], al
+        } else if (op == 0x2f) { // CPL
+            emit8(0x80); emit8(0xb3); emit32(offset(&cpu.regs[REG_A])); emit8(0xff); // xor byte [rbx+A], 0xff
+            or_f(0x60);
+        } else if (op == 0x37) { // SCF
+            and_f(0x80);
+            or_f(0x10);
+        } else if (op == 0x3f) { // CCF
+            and_f(0x90);
+            emit8(0x80); emit8(0xb3); emit32(f_off); emit8(0x10); // xor byte [rbx+F], 0x10
+        } else {
+            flush_pending();
+            uint64_t packed = (uint64_t)instr.opcode | ((uint64_t)instr.length << 8) |
+                              ((uint64_t)instr.cycles << 16) | ((uint64_t)instr.operand << 24);
+            emit8(0x48); emit8(0x89); emit8(0xdf);                      // mov rdi, rbx
+            emit8(0x48); emit8(0xbe); emit64(packed);                   // mov rsi, imm64
+            emit8(0x44); emit8(0x89); emit8(0xe2);                      // mov edx, r12d
+            emit8(0x48); emit8(0xb8); emit64((uint64_t)&Jit::exec_instr); // mov rax, imm64
+            emit8(0xff); emit8(0xd0);                                   // call rax
+            emit8(0x0f); emit8(0xb6); emit8(0xc8);                      // movzx ecx, al
+            emit8(0x41); emit8(0x01); emit8(0xcc);                      // add r12d, ecx
+            emit8(0x84); emit8(0xe4);                                   // test ah, ah (EXIT_BLOCK)
+            emit8(0x0f); emit8(0x85); exit_jumps.push_back(code_used); emit32(0); // jne exit
+            if (check_code) {
+                emit8(0x48); emit8(0xb8); emit64((uint64_t)&cpu.block_cache.code_changed); // mov rax, imm64
+                emit8(0x80); emit8(0x38); emit8(0x00);                  // cmp byte [rax], 0
+                emit8(0x0f); emit8(0x85); exit_jumps.push_back(code_used); emit32(0); // jne exit
+            }
+            continue;
+        }
+
+        pending_pc += instr.length;
+        pending_cycles += instr.cycles;
+    }
+    flush_pending();
+    block.native_cycles = cycles;
+
+    for (size_t pos : exit_jumps) {
+        uint32_t rel = (uint32_t)(code_used - (pos + 4));
+        memcpy(code + pos, &rel, 4);
+    }
+    emit8(0x44); emit8(0x89); emit8(0xe0);              // mov eax, r12d
+    emit8(0x48); emit8(0x83); emit8(0xc4); emit8(0x08); // add rsp, 8
+    emit8(0x41); emit8(0x5c);                           // pop r12
+    emit8(0x5b);                                        // pop rbx
+    emit8(0xc3);                                        // ret
+
+    return (NativeBlock)entry;
+#else
+    return nullptr;
+#endif
+}
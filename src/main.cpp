@@ -37,10 +37,10 @@ void drawRegsWindow(Cpu& cpu, Ppu& ppu)
 
     ImGui::Text("PC = %04x", cpu.pc);
     ImGui::Text("SP = %04x", cpu.sp);
-    ImGui::Text("Z = %d", cpu.z);
-    ImGui::Text("N = %d", cpu.n);
-    ImGui::Text("H = %d", cpu.h);
-    ImGui::Text("C = %d", cpu.c);
+    ImGui::Text("Z = %d", cpu.z());
+    ImGui::Text("N = %d", cpu.n());
+    ImGui::Text("H = %d", cpu.h());
+    ImGui::Text("C = %d", cpu.c());
 
     ImGui::Text("");
 
@@ -57,8 +57,8 @@ void drawRegsWindow(Cpu& cpu, Ppu& ppu)
     ImGui::Text("JOYP = %02x\n", cpu.joypad.joyp());
 
     ImGui::NewLine();
-    ImGui::Text("TIMA = %02x", cpu.timer->tima);
-    ImGui::Text("DIV = %02x", cpu.timer->div);
+    ImGui::Text("TIMA = %02x", cpu.timer->tima());
+    ImGui::Text("DIV = %02x", cpu.timer->div());
     ImGui::Text("TMA = %02x", cpu.timer->tma);
     ImGui::Text("TAC = %02x", cpu.timer->tac);
     ImGui::End();
@@ -243,10 +243,49 @@ struct FrameData {
     Inputs inputs;
 };
 
+const int CYCLES_PER_FRAME = 4194304 / 60;
+
+// Runs the ROM for the given number of frames without a window or audio
+// and prints the instruction throughput
+int benchmark(const char* path, int frames)
+{
+    SDL_AudioSpec spec{};
+    spec.freq = 44100;
+    spec.format = AUDIO_U16;
+    spec.channels = 1;
+    Apu apu(0, spec);
+
+    State state;
+    state.cpu.ppu = &state.ppu;
+    state.cpu.apu = &apu;
+    state.cpu.timer = &state.timer;
+    state.cpu.load(path);
+    state.cpu.map_io_ports();
+
+    uint64_t instructions = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int frame = 0; frame < frames; frame++) {
+        for (int i = 0; i < CYCLES_PER_FRAME;) {
+            RunResult res = state.cpu.run(CYCLES_PER_FRAME - i);
+            instructions += res.instructions;
+            i += res.cycles;
+        }
+    }
+    double seconds = (double)(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    printf("%d frames, %llu instructions in %.3f s: %.2f MIPS, %.1fx real time\n", frames,
+        (unsigned long long)instructions, seconds, instructions / seconds / 1e6, frames / 60.0 / seconds);
+    state.cpu.idle_loops.report(stdout, state.cpu.title);
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
+    if (argc >= 3 && strcmp(argv[1], "--bench") == 0) {
+        return benchmark(argv[2], argc >= 4 ? atoi(argv[3]) : 3600);
+    }
     if (argc != 2) {
-        fprintf(stderr, "Usage: %s <rom file>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <rom file>\n       %s --bench <rom file> [frames]\n", argv[0], argv[0]);
         return 1;
     }
 
@@ -313,16 +352,14 @@ int main(int argc, char** argv)
 
     SDL_Event e;
 
-    fill_opcode_table();
-
     Apu apu(audio_dev, obtained);
 
     State state;
-    state.cpu.load(argv[1]);
     state.cpu.ppu = &state.ppu;
     state.cpu.apu = &apu;
-    state.ppu.cpu = &state.cpu;
     state.cpu.timer = &state.timer;
+    state.cpu.load(argv[1]);
+    state.cpu.map_io_ports();
 
     ExecMode mode = MODE_STEP;
 
@@ -332,7 +369,6 @@ int main(int argc, char** argv)
     bool show_regs, show_instrs, show_mem, show_bgmap, show_tiles, show_oam, show_joypad;
     show_regs = show_instrs = show_mem = show_bgmap = show_tiles = show_oam = show_joypad = false;
 
-    const int CYCLES_PER_FRAME = 4194304 / 60;
     uint64_t instr_num = 0;
     Inputs inputs;
 
@@ -416,35 +452,26 @@ int main(int argc, char** argv)
 
         if (mode == MODE_STEP) {
             if (go_step) {
-                SideEffects eff = state.cpu.cycle();
-                state.ppu.exec(eff.cycles);
-                apu.exec(eff.cycles);
+                state.cpu.run_steps(1);
                 go_step = false;
                 instr_num++;
             } else if (go_step_back) {
-                uint64_t target = instr_num;
-                state.cpu.reset();
-                state.ppu.reset();
-                instr_num = 0;
-                while (instr_num + 1 != target)
-                {
-                    SideEffects eff = state.cpu.cycle();
-                    state.ppu.exec(eff.cycles);
-                    apu.exec(eff.cycles);
-                    instr_num++;
+                if (instr_num > 0) {
+                    instr_num--;
+                    state.cpu.reset();
+                    state.ppu.reset();
+                    state.timer.reset();
+                    state.cpu.run_steps(instr_num);
                 }
                 go_step_back = false;
             }
         } else {
             for (int i = 0; i < CYCLES_PER_FRAME;)
             {
-                SideEffects eff = state.cpu.cycle();
-                state.ppu.exec(eff.cycles);
-                apu.exec(eff.cycles);
-                instr_num++;
-                if (instr_num == 0) puts("overflow");
-                i += eff.cycles;
-                if (mode == MODE_RUNBREAK && eff.break_) {
+                RunResult res = state.cpu.run(CYCLES_PER_FRAME - i);
+                instr_num += res.instructions;
+                i += res.cycles;
+                if (mode == MODE_RUNBREAK && res.break_) {
                     mode = MODE_STEP;
                     go_step = false;
                     break;
@@ -464,6 +491,13 @@ int main(int argc, char** argv)
                 ImGui::Checkbox("OAM", &show_oam);
                 ImGui::EndMenu();
             }
+            if (ImGui::BeginMenu("Emulation")) {
+                ImGui::Checkbox("JIT", &state.cpu.use_jit);
+                ImGui::Checkbox("Fusion", &state.cpu.use_fusion);
+                ImGui::Checkbox("Skip idle loops", &state.cpu.skip_idle_loops);
+                ImGui::Checkbox("Lazy sync", &state.cpu.lazy_sync);
+                ImGui::EndMenu();
+            }
             ImGui::Text("Frame time: %f\n", frame_time_ms);
             ImGui::EndMainMenuBar();
         }
@@ -508,6 +542,11 @@ int main(int argc, char** argv)
         }
     }
 
+    state.cpu.idle_loops.report(stdout, state.cpu.title);
+#ifdef GBEMU_FUSION_PROFILE
+    state.cpu.fusion_profile.report(stdout);
+#endif
+
     ImGui_ImplOpenGL2_Shutdown();
     ImGui_ImplSDL2_Shutdown();
     SDL_GL_DeleteContext(gl_context);
@@ -14,6 +14,7 @@ void Mbc::load(uint8_t* cartridge, unsigned int size)
 
 Mbc0::Mbc0()
 {
+    type = MBC_0;
     rom = (uint8_t*)calloc(1, 0x8000);
     memset(rom, 0, 0x8000);
     memset(ram, 0, sizeof(ram));
@@ -40,8 +41,9 @@ void Mbc0::memw(uint16_t a, uint8_t v)
 
 Mbc1::Mbc1()
 {
+    type = MBC_1;
     rom = (uint8_t*)calloc(1, 0x200000);
-    ram = (uint8_t*)calloc(1, 0x8000);
+    memset(ram, 0, sizeof(ram));
     ram_enabled = false;
     rom_bank = 1;
     ram_bank = 1;
@@ -50,7 +52,7 @@ Mbc1::Mbc1()
 
 void Mbc1::reset()
 {
-    memset(ram, 0, 0x8000);
+    memset(ram, 0, sizeof(ram));
     ram_enabled = false;
     rom_bank = 1;
     ram_bank = 0;
@@ -105,7 +107,9 @@ void Mbc1::memw(uint16_t a, uint8_t v)
 
 Mbc2::Mbc2()
 {
+    type = MBC_2;
     rom = (uint8_t*)calloc(1, 256 * (1 << 10));
+    Mbc2::reset();
 }
 
 void Mbc2::reset()
@@ -147,16 +151,16 @@ void Mbc2::memw(uint16_t a, uint8_t v)
 
 Mbc3::Mbc3()
 {
+    type = MBC_3;
     static_assert(2*(1<<20) == 0x200000);
     static_assert(64 * (1<<10) == 0x10000);
     rom = (uint8_t*)calloc(1, 2 * (1 << 20));
-    ram = (uint8_t*)calloc(1, 64 * (1 << 10));
     Mbc3::reset();
 }
 
 void Mbc3::reset()
 {
-    memset(ram, 0, 64 * (1 << 10));
+    memset(ram, 0, sizeof(ram));
     ram_enabled = false;
     rom_bank = 1;
     ram_bank = 0;
@@ -256,16 +260,16 @@ void Mbc3::memw(uint16_t a, uint8_t v)
 
 Mbc5::Mbc5()
 {
+    type = MBC_5;
     static_assert(2*(1<<20) == 0x200000);
     static_assert(64 * (1<<10) == 0x10000);
     rom = (uint8_t*)calloc(1, 8 * (1 << 20));
-    ram = (uint8_t*)calloc(1, 64 * (1 << 10));
     Mbc5::reset();
 }
 
 void Mbc5::reset()
 {
-    memset(ram, 0, 64 * (1 << 10));
+    memset(ram, 0, sizeof(ram));
     ram_enabled = false;
     rom_bank = 1;
     ram_bank = 0;
@@ -20,7 +20,7 @@ constexpr uint8_t BG_OVER_OBJ_BIT = 1 << 7;
 
 Ppu::Ppu()
 {
-    cpu = nullptr;
+    frame_skip = 0;
     reset();
 }
 
@@ -32,6 +32,7 @@ void Ppu::reset()
     stat = 0x85;
     scx = scy = lyc = dma = bgp = obp0 = obp1 = wx = wy = 0;
     cycle_count = 0;
+    skipped_frames = 0;
     memset(vram, 0, sizeof(vram));
     memset(oam, 0, sizeof(oam));
     memset(framebuf, 0, sizeof(framebuf));
@@ -165,11 +166,12 @@ void Ppu::draw_scanline()
     }
 }
 
-void Ppu::exec(uint8_t cycles)
+void Ppu::exec(Cpu& cpu, unsigned int cycles)
 {
     cycles_since_last_vblank += cycles;
     if ((lcdc & LCD_ENABLE_BIT) == 0) return;
     cycle_count += cycles;
+    uint8_t mode = stat & 3;
     switch(stat & 0x3) {
         case MODE_OAM_SEARCH:
             if (cycle_count >= 80) {
@@ -186,32 +188,33 @@ void Ppu::exec(uint8_t cycles)
                 cycle_count -= 172;
 
                 if (stat & (1 << 3)) {
-                    cpu->if_ |= (1 << 1);
+                    cpu.if_ |= (1 << 1);
                 }
             }
             break;
 
         case MODE_HBLANK:
             if (cycle_count >= 204) {
-                draw_scanline();
+                if (skipped_frames == 0) draw_scanline();
 
                 ly++;
                 if (ly >= 144) {
                     stat &= ~(0b11);
                     stat |= MODE_VBLANK;
-                    cpu->if_ |= (1 << 0);
+                    cpu.if_ |= (1 << 0);
 
                     if (stat & (1 << 4)) {
-                        cpu->if_ |= (1 << 1);
+                        cpu.if_ |= (1 << 1);
                     }
 
                     cycles_since_last_vblank = 0;
+                    skipped_frames = skipped_frames < frame_skip ? skipped_frames + 1 : 0;
                 } else {
                     stat &= ~(0b11);
                     stat |= MODE_OAM_SEARCH;
 
                     if (stat & (1 << 5)) {
-                        cpu->if_ |= (1 << 1);
+                        cpu.if_ |= (1 << 1);
                     }
                 }
                 cycle_count -= 204;
@@ -227,7 +230,7 @@ void Ppu::exec(uint8_t cycles)
                     stat |= MODE_OAM_SEARCH;
 
                     if (stat & (1 << 5)) {
-                        cpu->if_ |= (1 << 1);
+                        cpu.if_ |= (1 << 1);
                     }
                 }
                 cycle_count -= 456;
@@ -236,8 +239,44 @@ void Ppu::exec(uint8_t cycles)
     }
 
     if (ly == lyc && (stat & (1 << 6))) {
-        cpu->if_ |= (1 << 1);
+        cpu.if_ |= (1 << 1);
     }
+
+    // VRAM is locked during pixel transfer
+    if ((stat & 3) != mode) cpu.map_video();
+}
+
+unsigned int Ppu::cycles_until_event() const
+{
+    if ((lcdc & LCD_ENABLE_BIT) == 0) return ~0u;
+    // exec() raises the LYC interrupt again on every call while LY == LYC
+    if (ly == lyc && (stat & (1 << 6))) return 0;
+    static const int mode_cycles[4] = { 204, 456, 80, 172 };
+    int cycles = mode_cycles[stat & 3] - cycle_count;
+    return cycles > 0 ? cycles : 0;
+}
+
+void Ppu::map_io(Cpu& cpu)
+{
+    cpu.map_io(0xFF40, &cpu, &lcdc, nullptr, [](void* ctx, uint8_t v) {
+        Cpu* cpu = (Cpu*)ctx;
+        cpu->ppu->lcdc = v;
+        cpu->map_video();
+    });
+    // the mode and coincidence bits are read-only
+    cpu.map_io(0xFF41, this, &stat, nullptr, [](void* ctx, uint8_t v) {
+        Ppu* ppu = (Ppu*)ctx;
+        ppu->stat = 0b10000000 | (v & 0b01111000) | (ppu->stat & 0b00000111);
+    });
+    cpu.map_io(0xFF42, &scy);
+    cpu.map_io(0xFF43, &scx);
+    cpu.map_io(0xFF44, this, &ly, nullptr, [](void*, uint8_t) {}); // read-only
+    cpu.map_io(0xFF45, &lyc);
+    cpu.map_io(0xFF47, &bgp);
+    cpu.map_io(0xFF48, &obp0);
+    cpu.map_io(0xFF49, &obp1);
+    cpu.map_io(0xFF4A, &wy);
+    cpu.map_io(0xFF4B, &wx);
 }
 
 bool Ppu::vramaccess()
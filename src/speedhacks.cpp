@@ -0,0 +1,24 @@
+#include "speedhacks.hpp"
+#include <string.h>
+
+// Entries go here once a title has been played through with them:
+// { "TITLE", checksum, loops, { { bank, address }, ... }, frame_skip },
+static const SpeedHack g_speedhacks[] = {
+    { nullptr, 0, 0, {}, 0 },
+};
+
+bool SpeedHack::has_wait_loop(uint16_t bank, uint16_t address) const
+{
+    for (unsigned int i = 0; i < num_wait_loops; i++) {
+        if (wait_loops[i].bank == bank && wait_loops[i].address == address) return true;
+    }
+    return false;
+}
+
+const SpeedHack* find_speedhack(uint8_t header_checksum, const char* title)
+{
+    for (const SpeedHack* hack = g_speedhacks; hack->title; hack++) {
+        if (hack->header_checksum == header_checksum && strncmp(hack->title, title, 16) == 0) return hack;
+    }
+    return nullptr;
+}
@@ -3,61 +3,102 @@
 
 Timer::Timer()
 {
-    div = 0x18;
-    tima = 0;
+    clock = nullptr;
+    reset();
+}
+
+void Timer::reset()
+{
     tma = 0;
     tac = 0xf8;
-
-    internal_timer = 0;
+    // Cpu::reset() sets the clock to 0, DIV is 0x18 after the boot ROM
+    counter_start = -(uint64_t)0x1800;
+    tima_base = 0;
+    tima_counter = 0x1800;
 }
 
-void Timer::update(uint8_t cycles, Cpu& cpu)
+// Cycles between two TIMA increments
+static unsigned int tima_period(uint8_t tac)
 {
-    unsigned int prev_internal_timer = internal_timer;
-
-    internal_timer += cycles;
-    div = internal_timer / 256;
+    switch(tac & 0b11) {
+        case 0: return 1024;
+        case 1: return 16;
+        case 2: return 64;
+        default: return 256;
+    }
+}
 
-    if (tac & (1 << 2)) {
+uint64_t Timer::counter() const
+{
+    return *clock - counter_start;
+}
 
-        unsigned int cycles_num;
-        switch(tac & 0b11) {
-            case 0:
-                cycles_num = 1024;
-                break;
+// TIMA increments each time the system counter reaches a multiple of the
+// period
+uint64_t Timer::overflow_counter() const
+{
+    unsigned int period = tima_period(tac);
+    return (tima_counter / period + 0x100 - tima_base) * period;
+}
 
-            case 1:
-                cycles_num = 16;
-                break;
+uint8_t Timer::div() const
+{
+    return counter() >> 8;
+}
 
-            case 2:
-                cycles_num = 64;
-                break;
+uint8_t Timer::tima() const
+{
+    if (!(tac & (1 << 2))) return tima_base;
+    unsigned int period = tima_period(tac);
+    uint64_t increments = counter() / period - tima_counter / period;
+    assert(increments <= 0xffu - tima_base);
+    return tima_base + increments;
+}
 
-            case 3:
-                cycles_num = 256;
-                break;
+void Timer::update(Cpu& cpu)
+{
+    if (!(tac & (1 << 2))) return;
+    uint64_t now = counter();
+    for (uint64_t overflow = overflow_counter(); overflow <= now; overflow = overflow_counter()) {
+        tima_base = tma;
+        tima_counter = overflow;
+        cpu.if_ |= (1 << 2);
+    }
+}
 
-            default:
-                assert(0);
-        }
+unsigned int Timer::cycles_until_event() const
+{
+    if (!(tac & (1 << 2))) return ~0u;
+    uint64_t now = counter();
+    uint64_t overflow = overflow_counter();
+    return overflow > now ? overflow - now : 0;
+}
 
-        unsigned int num_increments = (internal_timer / cycles_num) - (prev_internal_timer / cycles_num);
+void Timer::reset_div()
+{
+    tima_base = tima();
+    counter_start = *clock;
+    tima_counter = 0;
+}
 
-        for (unsigned int i = 0; i < num_increments; i++) {
-            if (tima == 0xff) {
-                tima = tma;
-                cpu.if_ |= (1 << 2);
-            } else {
-                tima++;
-            }
-        }
-    }
+void Timer::set_tima(uint8_t v)
+{
+    tima_base = v;
+    tima_counter = counter();
+}
 
-    internal_timer %= 1024;
+void Timer::set_tac(uint8_t v)
+{
+    tima_base = tima();
+    tima_counter = counter();
+    tac = v | 0b11111000;
 }
 
-void Timer::reset_timer()
+void Timer::map_io(Cpu& cpu)
 {
-    internal_timer = 0;
+    clock = &cpu.clock;
+    cpu.map_io(0xFF04, this, nullptr, [](void* ctx) { return ((Timer*)ctx)->div(); }, [](void* ctx, uint8_t) { ((Timer*)ctx)->reset_div(); });
+    cpu.map_io(0xFF05, this, nullptr, [](void* ctx) { return ((Timer*)ctx)->tima(); }, [](void* ctx, uint8_t v) { ((Timer*)ctx)->set_tima(v); });
+    cpu.map_io(0xFF06, &tma);
+    cpu.map_io(0xFF07, this, &tac, nullptr, [](void* ctx, uint8_t v) { ((Timer*)ctx)->set_tac(v); });
 }
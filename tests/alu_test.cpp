@@ -0,0 +1,126 @@
+// Exhaustive check of alu.hpp against straightforward reference code
+#include <stdio.h>
+#include "alu.hpp"
+
+static int failures = 0;
+
+static void check(const char* what, unsigned int in, unsigned int got, unsigned int expected)
+{
+    if (got == expected) return;
+    if (failures++ < 20) fprintf(stderr, "%s(%05x): got %02x, expected %02x\n", what, in, got, expected);
+}
+
+// Cpu::set_flags() before alu.hpp
+static uint8_t ref_flags(uint8_t op, uint8_t a, uint8_t b, uint8_t res, bool carry)
+{
+    bool h = false, c = false;
+    switch(op) {
+        case FLAGS_ADD: h = (a & 0xf) + (b & 0xf) + carry > 0xf; c = a + b + carry > 0xff; break;
+        case FLAGS_SUB: h = (b & 0xf) + carry > (a & 0xf); c = b + carry > a; break;
+        case FLAGS_AND: h = true; break;
+        case FLAGS_INC: h = (a & 0xf) == 0xf; c = carry; break;
+        case FLAGS_DEC: h = (a & 0xf) == 0; c = carry; break;
+    }
+    return ((res == 0) << 7) | ((op == FLAGS_SUB || op == FLAGS_DEC) << 6) | (h << 5) | (c << 4);
+}
+
+// Cpu::daa() before it used a table
+static AluResult ref_daa(uint8_t a, uint8_t f)
+{
+    int16_t result = a;
+    if (f & FLAG_N) {
+        if (f & FLAG_H) {
+            result = (result - 0x06) & 0xFF;
+        }
+        if (f & FLAG_C) {
+            result -= 0x60;
+        }
+    }
+    else {
+        if ((f & FLAG_H) || (result & 0x0F) > 0x09) {
+            result += 0x06;
+        }
+        if ((f & FLAG_C) || result > 0x9F) {
+            result += 0x60;
+        }
+    }
+    f &= FLAG_N | FLAG_C;
+    if ((result & 0x100) == 0x100) f |= FLAG_C;
+    if ((result & 0xff) == 0) f |= FLAG_Z;
+    return { (uint8_t)(result & 0xff), f };
+}
+
+// Cpu::instr_rlc() and friends before the shift table, op is bits 3-5 of
+// the CB opcode
+static AluResult ref_shift(unsigned int op, uint8_t v, bool c)
+{
+    bool old_c = c;
+    switch(op) {
+        case 0: c = v >> 7; v = (v << 1) | c; break;                 // RLC
+        case 1: c = v & 1; v = (v >> 1) | (c << 7); break;           // RRC
+        case 2: c = v >> 7; v = (v << 1) | old_c; break;             // RL
+        case 3: c = v & 1; v = (v >> 1) | (old_c << 7); break;       // RR
+        case 4: c = v >> 7; v <<= 1; break;                          // SLA
+        case 5: c = v & 1; v = (v >> 1) | (v & 0x80); break;         // SRA
+        case 6: v = (v << 4) | (v >> 4); c = false; break;           // SWAP
+        default: c = v & 1; v >>= 1; break;                          // SRL
+    }
+    return { v, (uint8_t)((v == 0 ? FLAG_Z : 0) | (c ? FLAG_C : 0)) };
+}
+
+// every op over every (carry, a, b)
+static void test_flags()
+{
+    static const char* names[] = { "none", "add", "sub", "and", "or", "inc", "dec" };
+    for (uint8_t op = FLAGS_ADD; op <= FLAGS_DEC; op++) {
+        for (unsigned int i = 0; i < 0x20000; i++) {
+            uint8_t a = i >> 8;
+            uint8_t b = i;
+            bool carry = i >> 16;
+            uint8_t res = 0;
+            switch(op) {
+                case FLAGS_ADD: res = a + b + carry; break;
+                case FLAGS_SUB: res = a - b - carry; break;
+                case FLAGS_AND: res = a & b; break;
+                case FLAGS_OR: res = a | b; break;
+                case FLAGS_INC: res = a + 1; break;
+                case FLAGS_DEC: res = a - 1; break;
+            }
+            uint8_t expected = ref_flags(op, a, b, res, carry);
+            check(names[op], i, alu_flags(op, a, b, res, carry), expected);
+            check(names[op], i, alu_c(op, a, b, carry), (expected & FLAG_C) != 0);
+        }
+    }
+}
+
+static void test_daa()
+{
+    for (unsigned int i = 0; i < 0x800; i++) {
+        uint8_t f = (i >> 8) << 4;
+        AluResult expected = ref_daa(i & 0xff, f);
+        check("daa.a", i, g_daa[i].v, expected.v);
+        check("daa.f", i, g_daa[i].f, expected.f);
+    }
+}
+
+static void test_shift()
+{
+    for (unsigned int i = 0; i < 0x1000; i++) {
+        AluResult expected = ref_shift(i >> 9, i & 0xff, (i >> 8) & 1);
+        check("shift.v", i, g_shift[i].v, expected.v);
+        check("shift.f", i, g_shift[i].f, expected.f);
+    }
+}
+
+int main()
+{
+    test_flags();
+    test_daa();
+    test_shift();
+    if (failures) {
+        fprintf(stderr, "%d failures\n", failures);
+        return 1;
+    }
+    printf("alu: ok\n");
+    return 0;
+}
@@ -0,0 +1,10 @@
+# cmake -DEAGER=<flags_test_eager> -DLAZY=<flags_test_lazy> -P flags_test.cmake
+execute_process(COMMAND ${EAGER} OUTPUT_VARIABLE eager RESULT_VARIABLE eager_result)
+execute_process(COMMAND ${LAZY} OUTPUT_VARIABLE lazy RESULT_VARIABLE lazy_result)
+if(NOT eager_result EQUAL 0 OR NOT lazy_result EQUAL 0)
+    message(FATAL_ERROR "flags_test: eager ${eager_result}, lazy ${lazy_result}")
+endif()
+if(NOT eager STREQUAL lazy)
+    message(FATAL_ERROR "flags_test: lazy flags differ\neager:\n${eager}lazy:\n${lazy}")
+endif()
+message("flags: ok")
@@ -0,0 +1,185 @@
+// Runs random flag-setting code followed by every kind of flag consumer
+// and prints hashes of what the program computed. Built with and without
+// GBEMU_LAZY_FLAGS, flags_test.cmake checks that both print the same.
+#include <stdio.h>
+#include <string.h>
+#include "cpu.hpp"
+#include "ppu.hpp"
+#include "apu.hpp"
+#include "timer.hpp"
+#include "mbc.hpp"
+
+constexpr unsigned int SEEDS = 16;
+constexpr unsigned int MAX_BLOCKS = 0x1800;
+constexpr uint16_t SUB_LD_B = 0x40;
+constexpr uint16_t SUB_RET_CC = 0x48;
+
+static uint8_t rom[0x8000];
+static uint32_t rng_state;
+
+static unsigned int rnd(unsigned int n)
+{
+    rng_state = rng_state * 1103515245 + 12345;
+    return (rng_state >> 16) % n;
+}
+
+// D and E hold the log pointer, everything else is fair game
+static uint8_t dst_reg()
+{
+    static const uint8_t r[] = { 0, 1, 4, 5, 7 };
+    return r[rnd(5)];
+}
+
+static uint8_t src_reg()
+{
+    static const uint8_t r[] = { 0, 1, 2, 3, 4, 5, 7 };
+    return r[rnd(7)];
+}
+
+static unsigned int emit_producer(unsigned int p)
+{
+    switch(rnd(14)) {
+        case 0: rom[p++] = 0x80 | (rnd(8) << 3) | src_reg(); break;               // ALU A,r
+        case 1: rom[p++] = 0xc6 | (rnd(8) << 3); rom[p++] = rnd(0x100); break;    // ALU A,n
+        case 2: rom[p++] = 0x04 | (dst_reg() << 3) | rnd(2); break;               // INC/DEC r
+        case 3: rom[p++] = 0x09 | (rnd(4) << 4); break;                           // ADD HL,rr
+        case 4: rom[p++] = 0x07 | (rnd(8) << 3); break;                           // RLCA .. CCF
+        case 5: rom[p++] = 0xcb; rom[p++] = (rnd(0x20) << 3) | dst_reg(); break;  // CB r
+        case 6: rom[p++] = 0x06 | (dst_reg() << 3); rom[p++] = rnd(0x100); break; // LD r,n
+        case 7: rom[p++] = 0x40 | (dst_reg() << 3) | src_reg(); break;            // LD r,r'
+        case 8: rom[p++] = 0x03 | (rnd(2) << 5) | (rnd(2) << 3); break;           // INC/DEC BC/HL
+        case 9: rom[p++] = 0xe8; rom[p++] = rnd(0x100);                           // ADD SP,e
+            rom[p++] = 0x31; rom[p++] = 0xf0; rom[p++] = 0xdf; break;             // LD SP,DFF0
+        case 10: rom[p++] = 0xf8; rom[p++] = rnd(0x100); break;                   // LD HL,SP+e
+        case 11: rom[p++] = 0xc5; rom[p++] = 0xf1; break;                         // PUSH BC; POP AF
+        case 12: rom[p++] = 0xf5; rom[p++] = 0xc1; break;                         // PUSH AF; POP BC
+        default: rom[p++] = 0x88 | (rnd(2) << 4) | src_reg(); break;              // ADC/SBC A,r
+    }
+    return p;
+}
+
+// Each consumer leaves a different B depending on the condition
+static unsigned int emit_consumer(unsigned int p)
+{
+    uint8_t cc = rnd(4);
+    switch(rnd(4)) {
+        case 0: // JR cc over LD B,n
+            rom[p++] = 0x20 | (cc << 3); rom[p++] = 2;
+            rom[p++] = 0x06; rom[p++] = rnd(0x100);
+            break;
+        case 1: { // JP cc over LD B,n
+            uint16_t target = p + 5;
+            rom[p++] = 0xc2 | (cc << 3); rom[p++] = target & 0xff; rom[p++] = target >> 8;
+            rom[p++] = 0x06; rom[p++] = rnd(0x100);
+            break;
+        }
+        case 2: // CALL cc
+            rom[p++] = 0xc4 | (cc << 3); rom[p++] = SUB_LD_B; rom[p++] = 0;
+            break;
+        default: // CALL to RET cc
+            rom[p++] = 0xcd; rom[p++] = SUB_RET_CC + cc * 4; rom[p++] = 0;
+            break;
+    }
+    return p;
+}
+
+// Returns the address of the final JR -2
+static uint16_t generate(unsigned int seed)
+{
+    memset(rom, 0, sizeof(rom));
+    rng_state = seed;
+    const uint8_t sub_ld_b[] = { 0x06, 0x5a, 0xc9 };
+    memcpy(rom + SUB_LD_B, sub_ld_b, sizeof(sub_ld_b));
+    for (uint8_t cc = 0; cc < 4; cc++) {
+        const uint8_t sub_ret_cc[] = { (uint8_t)(0xc0 | (cc << 3)), 0x06, 0xa5, 0xc9 };
+        memcpy(rom + SUB_RET_CC + cc * 4, sub_ret_cc, sizeof(sub_ret_cc));
+    }
+    // DI; LD SP,DFF0; LD DE,C000; JP 0150
+    const uint8_t entry[] = { 0xf3, 0x31, 0xf0, 0xdf, 0x11, 0x00, 0xc0, 0xc3, 0x50, 0x01 };
+    memcpy(rom + 0x100, entry, sizeof(entry));
+
+    unsigned int p = 0x150;
+    for (unsigned int i = 0; i < MAX_BLOCKS && p < 0x7f00; i++) {
+        for (unsigned int n = rnd(4) + 1; n > 0; n--) p = emit_producer(p);
+        if (rnd(2)) p = emit_consumer(p);
+        rom[p++] = 0x12; // LD (DE),A
+        rom[p++] = 0x13; // INC DE
+    }
+    rom[p] = 0x18;
+    rom[p + 1] = 0xfe;
+    return p;
+}
+
+static uint64_t hash(uint64_t h, uint64_t v)
+{
+    return (h ^ v) * 0x100000001b3ull;
+}
+
+// Everything but F, which is only up to date after af()
+static uint64_t hash_regs(uint64_t h, const Cpu& cpu)
+{
+    static const uint8_t r[] = { REG_A, REG_B, REG_C, REG_D, REG_E, REG_H, REG_L };
+    for (uint8_t i : r) h = hash(h, cpu.regs[i]);
+    h = hash(h, cpu.sp);
+    return hash(h, cpu.pc);
+}
+
+static void start(Cpu& cpu, Ppu& ppu, Timer& timer)
+{
+    cpu.reset();
+    ppu.reset();
+    timer.reset();
+    cpu.mbc->load(rom, sizeof(rom));
+    cpu.map_memory();
+}
+
+int main()
+{
+    SDL_AudioSpec spec{};
+    spec.freq = 44100;
+    spec.format = AUDIO_U16;
+    spec.channels = 1;
+    static Apu apu(0, spec);
+    static Cpu cpu;
+    static Ppu ppu;
+    static Timer timer;
+    cpu.ppu = &ppu;
+    cpu.apu = &apu;
+    cpu.timer = &timer;
+    cpu.mbc = new Mbc0();
+    cpu.map_io_ports();
+
+    for (unsigned int seed = 1; seed <= SEEDS; seed++) {
+        uint16_t end = generate(seed);
+
+        // instruction by instruction through step()
+        start(cpu, ppu, timer);
+        uint64_t steps = 0, step_hash = 0xcbf29ce484222325ull;
+        while (cpu.pc != end) {
+            cpu.run_steps(1);
+            step_hash = hash_regs(step_hash, cpu);
+            if (++steps > 1000000) {
+                fprintf(stderr, "seed %u: stuck at %04x\n", seed, cpu.pc);
+                return 1;
+            }
+        }
+        step_hash = hash(step_hash, cpu.af());
+
+        // through run(), which only leaves what the program logged
+        start(cpu, ppu, timer);
+        for (unsigned int i = 0; cpu.pc != end; i++) {
+            cpu.run(456);
+            if (i > 100000) {
+                fprintf(stderr, "seed %u: stuck at %04x\n", seed, cpu.pc);
+                return 1;
+            }
+        }
+        uint64_t run_hash = hash_regs(0xcbf29ce484222325ull, cpu);
+        run_hash = hash(run_hash, cpu.af());
+        for (uint8_t v : cpu.memory.wram) run_hash = hash(run_hash, v);
+
+        printf("seed %u: %llu steps, %016llx %016llx\n", seed, (unsigned long long)steps,
+            (unsigned long long)step_hash, (unsigned long long)run_hash);
+    }
+    return 0;
+}